@@ -0,0 +1,27 @@
+// Replacement of the global operator new and delete that counts heap allocations into the engine's counters,
+// for the bench report. It is linked into the chaos program only, so that libchaos.a never replaces the
+// allocator of a program that embeds it.
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include "chaos_internal.h"
+
+/**
+* Counts every heap allocation. Neither this nor operator delete is inlined,
+* as the compiler would then see a block from operator new handed to free.
+*/
+__attribute__((noinline)) void *operator new(size_t size){
+	chaos::heap_allocations.fetch_add(1, std::memory_order_relaxed);
+	chaos::thread_allocations++;
+	void *block = std::malloc(size ? size : 1);
+	if (block == nullptr){
+		throw std::bad_alloc();
+	}
+	return block;
+}
+
+__attribute__((noinline)) void operator delete(void *block) noexcept{
+	std::free(block);
+}
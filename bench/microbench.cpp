@@ -0,0 +1,477 @@
+#include <SDL2/SDL.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <getopt.h>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <unordered_map>
+#include <cstdlib>
+
+#include "chaos_engine.h"
+#include "chaos_internal.h"
+
+using namespace chaos;
+
+// Microbenchmarks of the hot components on their own: the random number generators, the grid that
+// deduplicates points, the step kernels and the window's two ways of submitting points. Every case reports
+// its best time per operation over REPETITIONS runs of at least MIN_SECONDS, and is compared to a JSON
+// baseline of an earlier run, failing if it is more than tolerance percent slower.
+
+const int REPETITIONS = 15;
+const double MIN_SECONDS = 0.02;
+
+// Grid the dedup, kernel and render cases play on, and the points of a window frame, stepping iterations
+const uint32_t GRID_SIZE = 1000;
+const uint32_t FRAME_POINTS = 2500;
+
+// Number of attractor points generated for the dedup and render cases
+const size_t NUM_POINTS = 1 << 20;
+
+// Steps of every SIMD kernel call, as many as a run makes per call
+const size_t KERNEL_STEPS = 256;
+
+std::string baseline_path = "bench/baseline.json";
+std::string results_path;
+std::string filter;
+double tolerance = 10;
+bool flag_update = false;
+
+// Result of a case, in nanoseconds per operation
+struct Result {
+	std::string name;
+	double ns_per_op;
+};
+
+// Sum of the checksums of the cases, kept so that the compiler cannot drop their work
+volatile uint64_t sink = 0;
+
+const option long_opts[] = {
+	{"baseline", 1, 0, 'b'},
+	{"tolerance", 1, 0, 't'},
+	{"update", 0, 0, 'u'},
+	{"output", 1, 0, 'o'},
+	{"filter", 1, 0, 'f'},
+	{"help", 0, 0, 'h'},
+	{0, 0, 0, 0}
+};
+
+/**
+* Returns whether cases starting with prefix run, given --filter.
+*/
+bool wanted(const std::string &prefix){
+	return filter.empty() || prefix.find(filter) != std::string::npos || filter.find(prefix) != std::string::npos;
+}
+
+/**
+* Times a case. The number of operations is doubled until a run takes MIN_SECONDS, then the best of
+* REPETITIONS runs of that many operations is kept.
+* @param results: Receives the time per operation, unless the case is filtered out
+* @param name: Name of the case, group/variant
+* @param run: Runs at least a number of operations, adding a checksum of them to sink, and returns how many it ran
+*/
+template <class Run>
+void measure(std::vector<Result> &results, const std::string &name, Run run){
+	if (!filter.empty() && name.find(filter) == std::string::npos){
+		return;
+	}
+	uint64_t ops = 1024;
+	double best = 0;
+	for (int r = 0; r < REPETITIONS; r++){
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		uint64_t done = run(ops);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (r == 0 && seconds < MIN_SECONDS){
+			ops *= 2;
+			r--;
+			continue;
+		}
+		if (r == 0 || seconds / done < best){
+			best = seconds / done;
+		}
+	}
+	results.push_back(Result {name, best * 1e9});
+	std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(3)
+		<< std::setw(10) << results.back().ns_per_op << " ns/op" << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+	std::cout << std::setprecision(6);
+}
+
+/**
+* Times one draw of every generator, the 64-bit output of SplitMix64 and Xoshiro256 and the 32-bit output of Pcg32.
+*/
+void bench_rngs(std::vector<Result> &results){
+	SplitMix64 splitmix;
+	splitmix.seed(1, 0);
+	measure(results, "rng/splitmix", [&](uint64_t ops){
+		uint64_t sum = 0;
+		for (uint64_t i = 0; i < ops; i++){
+			sum += splitmix.next();
+		}
+		sink = sink + sum;
+		return ops;
+	});
+	Xoshiro256 xoshiro;
+	xoshiro.seed(1, 0);
+	measure(results, "rng/xoshiro256", [&](uint64_t ops){
+		uint64_t sum = 0;
+		for (uint64_t i = 0; i < ops; i++){
+			sum += xoshiro.next();
+		}
+		sink = sink + sum;
+		return ops;
+	});
+	Pcg32 pcg;
+	pcg.seed(1, 0);
+	measure(results, "rng/pcg32", [&](uint64_t ops){
+		uint64_t sum = 0;
+		for (uint64_t i = 0; i < ops; i++){
+			sum += pcg.next_u32();
+		}
+		sink = sink + sum;
+		return ops;
+	});
+}
+
+/**
+* Plays the game on the vertices of a game, at a fraction of 0.5, for the points the dedup and render cases use.
+*/
+void attractor_points(const Game &game, std::vector<Point> &points){
+	Xoshiro256 rng;
+	rng.seed(2, 0);
+	float x = game.vertex_x[0], y = game.vertex_y[0];
+	points.resize(NUM_POINTS);
+	for (size_t p = 0; p < points.size(); p++){
+		uint32_t vertex = uniform_below(rng, game.num_vertices);
+		x += (game.vertex_x[vertex] - x) * 0.5f;
+		y += (game.vertex_y[vertex] - y) * 0.5f;
+		points[p] = Point {uint32_t (x), uint32_t (y)};
+	}
+}
+
+/**
+* Times the deduplication of one point: by a hash map keyed by cell index, the bit of the occupancy grid,
+* and the hit count of the density buffer.
+*/
+void bench_dedup(std::vector<Result> &results){
+	ChaosConfig config;
+	config.width = GRID_SIZE;
+	config.height = GRID_SIZE;
+	std::vector<Point> points;
+	{
+		Game game;
+		game.setup(config, nullptr);
+		attractor_points(game, points);
+		std::unordered_map<double, bool> seen;
+		measure(results, "dedup/unordered_map", [&](uint64_t ops){
+			uint64_t found = 0;
+			for (uint64_t i = 0; i < ops; i++){
+				const Point &point = points[i & (NUM_POINTS - 1)];
+				bool &marked = seen[double (point.y) * GRID_SIZE + point.x];
+				found += !marked;
+				marked = true;
+			}
+			sink = sink + found;
+			return ops;
+		});
+		measure(results, "dedup/bitmap", [&](uint64_t ops){
+			uint64_t found = 0;
+			for (uint64_t i = 0; i < ops; i++){
+				const Point &point = points[i & (NUM_POINTS - 1)];
+				found += game.mark_index(uint64_t (point.y) * game.render_width + point.x);
+			}
+			sink = sink + found;
+			return ops;
+		});
+	}
+	config.density = true;
+	Game game;
+	game.setup(config, nullptr);
+	measure(results, "dedup/density", [&](uint64_t ops){
+		uint64_t found = 0;
+		for (uint64_t i = 0; i < ops; i++){
+			const Point &point = points[i & (NUM_POINTS - 1)];
+			found += game.density[game.density_index(point.x, point.y)].fetch_add(1, std::memory_order_relaxed) == 0;
+		}
+		sink = sink + found;
+		return ops;
+	});
+}
+
+/**
+* Times one iteration of every step kernel the CPU supports, on one walker of a triangle at a fraction of 0.55,
+* which none of the scalar loops specializes. The scalar and fixed loops run on the walker, marking the occupancy
+* grid as a run does. The SIMD kernels, and the lanes kernel, only fill their coordinate buffers, KERNEL_STEPS
+* steps at a time, so that their own cost is timed apart from plotting the points.
+*/
+void bench_kernels(std::vector<Result> &results){
+	for (int k = 0; k <= KERNEL_LANES; k++){
+		SimdKernel kernel = find_simd_kernel(KernelKind (k));
+		if (k != KERNEL_SCALAR && k != KERNEL_FIXED && kernel == nullptr){
+			continue;
+		}
+		ChaosConfig config;
+		config.width = GRID_SIZE;
+		config.height = GRID_SIZE;
+		config.fraction = 0.55f;
+		config.kernel = KERNEL_NAMES[k];
+		Game game;
+		game.setup(config, nullptr);
+		Walker &walker = game.walkers[0];
+		if (kernel == nullptr){
+			measure(results, std::string ("kernel/") + KERNEL_NAMES[k], [&](uint64_t ops){
+				uint64_t done = (game.*game.walker_loop)(walker, ops, RECORD_NONE);
+				sink = sink + walker.num_points;
+				return done;
+			});
+			continue;
+		}
+		SimdParams params = {game.vertex_x.data(), game.vertex_y.data(), game.num_vertices, game.factor, game.die_threshold};
+		std::vector<uint32_t> xs(KERNEL_STEPS * SIMD_LANES), ys(KERNEL_STEPS * SIMD_LANES);
+		measure(results, std::string ("kernel/") + KERNEL_NAMES[k], [&](uint64_t ops){
+			uint64_t done = 0;
+			for (; done < ops; done += KERNEL_STEPS * SIMD_LANES){
+				kernel(walker.lanes, params, xs.data(), ys.data(), nullptr, KERNEL_STEPS);
+			}
+			sink = sink + xs.back() + ys.back();
+			return done;
+		});
+	}
+}
+
+/**
+* Times the submission of one point to a hidden window, in frames of FRAME_POINTS points: as a rect filled
+* onto a target texture, and as a pixel of the buffer uploaded to a streaming texture, each frame then
+* copied to the window and presented. Skipped when SDL cannot open the window.
+*/
+void bench_render(std::vector<Result> &results){
+	ChaosConfig config;
+	config.width = GRID_SIZE;
+	config.height = GRID_SIZE;
+	std::vector<Point> points;
+	{
+		Game game;
+		game.setup(config, nullptr);
+		attractor_points(game, points);
+	}
+	if (SDL_Init(SDL_INIT_VIDEO) != 0){
+		std::cerr << "Skipping the render cases, SDL_Init error: " << SDL_GetError() << std::endl;
+		return;
+	}
+	SDL_Window *window = SDL_CreateWindow("microbench", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+		GRID_SIZE, GRID_SIZE, SDL_WINDOW_HIDDEN);
+	SDL_Renderer *renderer = window ? SDL_CreateRenderer(window, -1, SDL_RENDERER_TARGETTEXTURE) : nullptr;
+	SDL_Texture *target = renderer ? SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, GRID_SIZE, GRID_SIZE) : nullptr;
+	SDL_Texture *streaming = renderer ? SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, GRID_SIZE, GRID_SIZE) : nullptr;
+	if (target == nullptr || streaming == nullptr){
+		std::cerr << "Skipping the render cases, SDL error: " << SDL_GetError() << std::endl;
+	}
+	else{
+		std::vector<SDL_Rect> rects;
+		rects.reserve(FRAME_POINTS);
+		measure(results, "render/fill_rects", [&](uint64_t ops){
+			uint64_t i = 0;
+			for (; i < ops; i += FRAME_POINTS){
+				for (uint64_t p = i; p < i + FRAME_POINTS; p++){
+					const Point &point = points[p & (NUM_POINTS - 1)];
+					rects.push_back(SDL_Rect {int (point.x), int (point.y), 1, 1});
+				}
+				SDL_SetRenderTarget(renderer, target);
+				SDL_SetRenderDrawColor(renderer, CHAOS_POINTS[0], CHAOS_POINTS[1], CHAOS_POINTS[2], 0xFF);
+				SDL_RenderFillRects(renderer, rects.data(), rects.size());
+				rects.clear();
+				SDL_SetRenderTarget(renderer, nullptr);
+				SDL_RenderCopy(renderer, target, nullptr, nullptr);
+				SDL_RenderPresent(renderer);
+			}
+			return i;
+		});
+		std::vector<uint32_t> frame(GRID_SIZE * GRID_SIZE, ChaosEngine::argb(CHAOS_BACKGROUND));
+		uint32_t colour = ChaosEngine::argb(CHAOS_POINTS);
+		measure(results, "render/texture_upload", [&](uint64_t ops){
+			uint64_t i = 0;
+			for (; i < ops; i += FRAME_POINTS){
+				for (uint64_t p = i; p < i + FRAME_POINTS; p++){
+					const Point &point = points[p & (NUM_POINTS - 1)];
+					frame[point.y * GRID_SIZE + point.x] = colour;
+				}
+				SDL_UpdateTexture(streaming, nullptr, frame.data(), GRID_SIZE * sizeof(uint32_t));
+				SDL_RenderCopy(renderer, streaming, nullptr, nullptr);
+				SDL_RenderPresent(renderer);
+			}
+			return i;
+		});
+	}
+	if (streaming != nullptr){
+		SDL_DestroyTexture(streaming);
+	}
+	if (target != nullptr){
+		SDL_DestroyTexture(target);
+	}
+	if (renderer != nullptr){
+		SDL_DestroyRenderer(renderer);
+	}
+	if (window != nullptr){
+		SDL_DestroyWindow(window);
+	}
+	SDL_Quit();
+}
+
+/**
+* Writes results as a JSON array of cases, one per line.
+*/
+bool write_results(const std::vector<Result> &results, const std::string &path){
+	std::ofstream file(path.c_str());
+	file << "[\n";
+	for (size_t i = 0; i < results.size(); i++){
+		file << "  {\"name\": \"" << results[i].name << "\", \"ns_per_op\": " << results[i].ns_per_op
+			<< ", \"ops_per_second\": " << uint64_t (1e9 / results[i].ns_per_op) << "}" << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	file << "]\n";
+	return bool (file);
+}
+
+/**
+* Reads the results written by write_results.
+* @return false if the file could not be read.
+*/
+bool read_results(std::vector<Result> &results, const std::string &path){
+	std::ifstream file(path.c_str());
+	if (!file){
+		return false;
+	}
+	std::string line;
+	while (std::getline(file, line)){
+		size_t name = line.find("\"name\": \"");
+		size_t time = line.find("\"ns_per_op\": ");
+		if (name == std::string::npos || time == std::string::npos){
+			continue;
+		}
+		name += 9;
+		results.push_back(Result {line.substr(name, line.find('"', name) - name), std::atof(line.c_str() + time + 13)});
+	}
+	return true;
+}
+
+/**
+* Compares results to a baseline, case by case.
+* @return The number of cases more than tolerance percent slower than their baseline.
+*/
+int compare_results(const std::vector<Result> &results, const std::vector<Result> &baseline){
+	int regressions = 0;
+	std::cout << std::endl << std::left << std::setw(28) << "case" << std::right << std::setw(10) << "ns/op"
+		<< std::setw(12) << "baseline" << std::setw(10) << "change" << std::endl;
+	for (size_t i = 0; i < results.size(); i++){
+		std::cout << std::left << std::setw(28) << results[i].name << std::right << std::fixed << std::setprecision(3)
+			<< std::setw(10) << results[i].ns_per_op;
+		size_t b = 0;
+		while (b < baseline.size() && baseline[b].name != results[i].name){
+			b++;
+		}
+		if (b == baseline.size() || baseline[b].ns_per_op <= 0){
+			std::cout << std::setw(12) << "-" << std::setw(10) << "new" << std::endl;
+			continue;
+		}
+		double change = (results[i].ns_per_op / baseline[b].ns_per_op - 1) * 100;
+		std::cout << std::setw(12) << baseline[b].ns_per_op << std::setw(9) << std::showpos << std::setprecision(1)
+			<< change << "%" << std::noshowpos;
+		if (change > tolerance){
+			std::cout << "  REGRESSION";
+			regressions++;
+		}
+		std::cout << std::endl;
+	}
+	std::cout.unsetf(std::ios::floatfield);
+	std::cout << std::setprecision(6);
+	return regressions;
+}
+
+int main(int argc, char *argv[]){
+	int c;
+	double value;
+	while ((c = getopt_long(argc, argv, "b:t:uo:f:h", long_opts, nullptr)) != -1){
+		switch (c){
+			case 'b':
+				baseline_path = optarg;
+				break;
+
+			case 't':
+				if (ChaosEngine::parse_number(optarg, value) && value > 0.0){
+					tolerance = value;
+					std::cout << "Tolerance set to " << tolerance << "%." << std::endl;
+				}
+				else{
+					std::cout << "Invalid tolerance. Defaulting to " << tolerance << "%." << std::endl;
+				}
+				break;
+
+			case 'u':
+				flag_update = true;
+				break;
+
+			case 'o':
+				results_path = optarg;
+				break;
+
+			case 'f':
+				filter = optarg;
+				break;
+
+			case 'h':
+				std::cout << "Usage: microbench [OPTIONS]" << std::endl;
+				std::cout << " -b PATH, --baseline PATH    JSON baseline to compare with, written by --update (default: " << baseline_path << ")" << std::endl;
+				std::cout << " -t N, --tolerance N         percentage by which a case may be slower than its baseline (default: " << tolerance << ")" << std::endl;
+				std::cout << " -u, --update                write the results to the baseline instead of comparing" << std::endl;
+				std::cout << " -o PATH, --output PATH      also write the results to a JSON file" << std::endl;
+				std::cout << " -f TEXT, --filter TEXT      only run the cases whose name contains TEXT, such as rng/ or kernel/" << std::endl;
+				std::cout << " -h, --help                  show this help" << std::endl;
+				return 0;
+
+			default:
+				return 1;
+		}
+	}
+
+	// Without a baseline there is nothing to gate on, which fails before any case runs instead of passing
+	std::vector<Result> baseline;
+	if (!flag_update && !read_results(baseline, baseline_path)){
+		std::cerr << "Could not read baseline " << baseline_path << ". Record one with --update, or make microbench-baseline." << std::endl;
+		return 1;
+	}
+
+	std::vector<Result> results;
+	if (wanted("rng/")){
+		bench_rngs(results);
+	}
+	if (wanted("dedup/")){
+		bench_dedup(results);
+	}
+	if (wanted("kernel/")){
+		bench_kernels(results);
+	}
+	if (wanted("render/")){
+		bench_render(results);
+	}
+	if (!results_path.empty() && !write_results(results, results_path)){
+		std::cerr << "Could not write results to " << results_path << "." << std::endl;
+		return 1;
+	}
+
+	if (flag_update){
+		if (!write_results(results, baseline_path)){
+			std::cerr << "Could not write baseline to " << baseline_path << "." << std::endl;
+			return 1;
+		}
+		std::cout << "Baseline written to " << baseline_path << "." << std::endl;
+		return 0;
+	}
+	int regressions = compare_results(results, baseline);
+	if (regressions > 0){
+		std::cout << regressions << " case(s) regressed by more than " << tolerance << "% against " << baseline_path << "." << std::endl;
+		return 1;
+	}
+	std::cout << "No case regressed by more than " << tolerance << "% against " << baseline_path << "." << std::endl;
+	return 0;
+}
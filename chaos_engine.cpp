@@ -0,0 +1,3137 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <signal.h>
+#include <unistd.h>
+#include <sstream>
+#include <fstream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <list>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <cmath>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <cctype>
+#include <cstdlib>
+#include <zlib.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265
+#endif
+
+#include "chaos_engine.h"
+#include "chaos_internal.h"
+
+namespace chaos {
+
+// The parameters and state of a game are documented in chaos_internal.h
+
+const float SCREEN_MARGINS = 0.05;
+const int FIXED_SHIFT = 8;
+const int Q32_SHIFT = 32;
+
+const size_t HUGE_PAGE = 2 << 20;
+const size_t ARENA_ALIGN = 64;
+
+std::atomic<uint64_t> heap_allocations(0);
+thread_local uint64_t thread_allocations = 0;
+
+Arena::~Arena(){
+	if (base != nullptr){
+		munmap(base, capacity);
+	}
+}
+
+/**
+* Maps a new arena of at least size bytes in place of the current one, none of whose blocks may still be in use.
+*/
+void Arena::map(size_t size){
+	if (base != nullptr){
+		munmap(base, capacity);
+	}
+	size = (size + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+	void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	huge_pages = memory != MAP_FAILED;
+	if (!huge_pages){
+		memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+		if (memory != MAP_FAILED){
+			madvise(memory, size, MADV_HUGEPAGE);
+		}
+#endif
+	}
+	used = 0;
+	if (memory == MAP_FAILED){
+		base = nullptr;
+		capacity = 0;
+		huge_pages = false;
+		return;
+	}
+	base = static_cast<uint8_t *>(memory);
+	capacity = size;
+}
+
+/**
+* Allocates a block from the arena, or from the heap once the arena is full.
+*/
+void *Arena::allocate(size_t size){
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t start = (used + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+	if (base != nullptr && start <= capacity && size <= capacity - start){
+		used = start + size;
+		return base + start;
+	}
+	return ::operator new(size);
+}
+
+/**
+* Releases a block allocated by allocate. Blocks of the arena are only reclaimed by rewinding it.
+*/
+void Arena::release(void *block){
+	uint8_t *bytes = static_cast<uint8_t *>(block);
+	if (base == nullptr || bytes < base || bytes >= base + capacity){
+		::operator delete(block);
+	}
+}
+
+const char *TONE_NAMES[] = {"log", "gamma"};
+
+const uint32_t TILE_SHIFT = 9;
+const uint32_t TILE_MASK = (1 << TILE_SHIFT) - 1;
+const size_t TILE_BIN_POINTS = 1 << 20;
+
+const char *IMAGE_FORMAT_NAMES[] = {"ppm", "png"};
+const uint32_t EXPORT_BAND_ROWS = 64;
+const int PNG_LEVEL = 1;
+
+const char *STREAM_FORMAT_NAMES[] = {"raw", "varint"};
+const char STREAM_MAGIC[8] = {'C', 'H', 'A', 'O', 'S', 'P', 'T', 'S'};
+const uint32_t STREAM_VERSION = 1;
+const size_t STREAM_BUFFER = 1 << 20;
+
+const char *KERNEL_NAMES[] = {"scalar", "sse4", "avx2", "avx512", "neon", "fixed", "lanes"};
+
+/**
+* Scalar kernel of the SIMD step rule, one lane at a time: the same xoshiro128+ streams, dice and float moves,
+* truncated to cells, as the SIMD kernels, so that it draws the same points as any of them. It runs as the lanes
+* kernel, the reference of the SIMD kernels, and they replay a call on it when one of their dice has to be redrawn.
+* Multiplies and adds are never fused, as they are not in the SIMD kernels.
+*/
+__attribute__((optimize("fp-contract=off")))
+void simd_kernel_scalar(SimdLanes &lanes, const SimdParams &params, uint32_t *xs, uint32_t *ys, uint32_t *vs, size_t steps){
+	const float keep = 1.0f - params.factor, move = params.factor;
+	for (size_t step = 0; step < steps; step++){
+		for (int l = 0; l < SIMD_LANES; l++){
+			uint32_t result = next_lane(lanes.s0[l], lanes.s1[l], lanes.s2[l], lanes.s3[l]);
+			uint32_t die = lane_die(result, lanes.s0[l], lanes.s1[l], lanes.s2[l], lanes.s3[l], params.num_vertices, params.die_threshold);
+			lanes.x[l] = lanes.x[l] * keep + params.vertex_x[die] * move;
+			lanes.y[l] = lanes.y[l] * keep + params.vertex_y[die] * move;
+			xs[step * SIMD_LANES + l] = int32_t (lanes.x[l]);
+			ys[step * SIMD_LANES + l] = int32_t (lanes.y[l]);
+			if (vs != nullptr){
+				vs[step * SIMD_LANES + l] = die;
+			}
+		}
+	}
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/**
+* SSE4.1 kernel, four groups of four lanes. SSE has no gather, so vertices are loaded one lane at a time.
+*/
+__attribute__((target("sse4.1")))
+void simd_kernel_sse4(SimdLanes &lanes, const SimdParams &params, uint32_t *xs, uint32_t *ys, uint32_t *vs, size_t steps){
+	const int GROUPS = SIMD_LANES / 4;
+	const __m128 keep = _mm_set1_ps(1.0f - params.factor);
+	const __m128 move = _mm_set1_ps(params.factor);
+	const __m128i range = _mm_set1_epi32(params.num_vertices);
+	const __m128i threshold = _mm_set1_epi32(params.die_threshold);
+	const SimdLanes start = lanes;
+	__m128i unbiased = _mm_set1_epi32(-1);
+	__m128 x[GROUPS], y[GROUPS];
+	__m128i s0[GROUPS], s1[GROUPS], s2[GROUPS], s3[GROUPS];
+	for (int g = 0; g < GROUPS; g++){
+		x[g] = _mm_loadu_ps(lanes.x + g * 4);
+		y[g] = _mm_loadu_ps(lanes.y + g * 4);
+		s0[g] = _mm_loadu_si128((const __m128i *) (lanes.s0 + g * 4));
+		s1[g] = _mm_loadu_si128((const __m128i *) (lanes.s1 + g * 4));
+		s2[g] = _mm_loadu_si128((const __m128i *) (lanes.s2 + g * 4));
+		s3[g] = _mm_loadu_si128((const __m128i *) (lanes.s3 + g * 4));
+	}
+	for (size_t step = 0; step < steps; step++){
+		for (int g = 0; g < GROUPS; g++){
+			__m128i result = _mm_add_epi32(s0[g], s3[g]);
+			__m128i t = _mm_slli_epi32(s1[g], 9);
+			s2[g] = _mm_xor_si128(s2[g], s0[g]);
+			s3[g] = _mm_xor_si128(s3[g], s1[g]);
+			s1[g] = _mm_xor_si128(s1[g], s2[g]);
+			s0[g] = _mm_xor_si128(s0[g], s3[g]);
+			s2[g] = _mm_xor_si128(s2[g], t);
+			s3[g] = _mm_or_si128(_mm_slli_epi32(s3[g], 11), _mm_srli_epi32(s3[g], 21));
+
+			// The die is the high half of result * num_vertices, multiplied in the even and the odd lanes. A low half in
+			// the biased region has the whole call replayed on the scalar kernel, which redraws the die.
+			uint32_t die[4];
+			__m128i even = _mm_mul_epu32(result, range);
+			__m128i odd = _mm_mul_epu32(_mm_srli_epi64(result, 32), range);
+			__m128i low = _mm_blend_epi16(even, _mm_slli_epi64(odd, 32), 0xCC);
+			_mm_storeu_si128((__m128i *) die, _mm_blend_epi16(_mm_srli_epi64(even, 32), odd, 0xCC));
+			unbiased = _mm_and_si128(unbiased, _mm_cmpeq_epi32(_mm_max_epu32(low, threshold), low));
+			__m128 vx = _mm_set_ps(params.vertex_x[die[3]], params.vertex_x[die[2]], params.vertex_x[die[1]], params.vertex_x[die[0]]);
+			__m128 vy = _mm_set_ps(params.vertex_y[die[3]], params.vertex_y[die[2]], params.vertex_y[die[1]], params.vertex_y[die[0]]);
+
+			x[g] = _mm_add_ps(_mm_mul_ps(x[g], keep), _mm_mul_ps(vx, move));
+			y[g] = _mm_add_ps(_mm_mul_ps(y[g], keep), _mm_mul_ps(vy, move));
+			_mm_storeu_si128((__m128i *) (xs + step * SIMD_LANES + g * 4), _mm_cvttps_epi32(x[g]));
+			_mm_storeu_si128((__m128i *) (ys + step * SIMD_LANES + g * 4), _mm_cvttps_epi32(y[g]));
+			if (vs != nullptr){
+				std::memcpy(vs + step * SIMD_LANES + g * 4, die, sizeof(die));
+			}
+		}
+	}
+	for (int g = 0; g < GROUPS; g++){
+		_mm_storeu_ps(lanes.x + g * 4, x[g]);
+		_mm_storeu_ps(lanes.y + g * 4, y[g]);
+		_mm_storeu_si128((__m128i *) (lanes.s0 + g * 4), s0[g]);
+		_mm_storeu_si128((__m128i *) (lanes.s1 + g * 4), s1[g]);
+		_mm_storeu_si128((__m128i *) (lanes.s2 + g * 4), s2[g]);
+		_mm_storeu_si128((__m128i *) (lanes.s3 + g * 4), s3[g]);
+	}
+	if (_mm_movemask_ps(_mm_castsi128_ps(unbiased)) != 0xF){
+		lanes = start;
+		simd_kernel_scalar(lanes, params, xs, ys, vs, steps);
+	}
+}
+
+/**
+* AVX2 kernel, two groups of eight lanes, with gathered vertex loads.
+*/
+__attribute__((target("avx2")))
+void simd_kernel_avx2(SimdLanes &lanes, const SimdParams &params, uint32_t *xs, uint32_t *ys, uint32_t *vs, size_t steps){
+	const int GROUPS = SIMD_LANES / 8;
+	const __m256 keep = _mm256_set1_ps(1.0f - params.factor);
+	const __m256 move = _mm256_set1_ps(params.factor);
+	const __m256i range = _mm256_set1_epi32(params.num_vertices);
+	const __m256i threshold = _mm256_set1_epi32(params.die_threshold);
+	const SimdLanes start = lanes;
+	__m256i unbiased = _mm256_set1_epi32(-1);
+	__m256 x[GROUPS], y[GROUPS];
+	__m256i s0[GROUPS], s1[GROUPS], s2[GROUPS], s3[GROUPS];
+	for (int g = 0; g < GROUPS; g++){
+		x[g] = _mm256_loadu_ps(lanes.x + g * 8);
+		y[g] = _mm256_loadu_ps(lanes.y + g * 8);
+		s0[g] = _mm256_loadu_si256((const __m256i *) (lanes.s0 + g * 8));
+		s1[g] = _mm256_loadu_si256((const __m256i *) (lanes.s1 + g * 8));
+		s2[g] = _mm256_loadu_si256((const __m256i *) (lanes.s2 + g * 8));
+		s3[g] = _mm256_loadu_si256((const __m256i *) (lanes.s3 + g * 8));
+	}
+	for (size_t step = 0; step < steps; step++){
+		for (int g = 0; g < GROUPS; g++){
+			__m256i result = _mm256_add_epi32(s0[g], s3[g]);
+			__m256i t = _mm256_slli_epi32(s1[g], 9);
+			s2[g] = _mm256_xor_si256(s2[g], s0[g]);
+			s3[g] = _mm256_xor_si256(s3[g], s1[g]);
+			s1[g] = _mm256_xor_si256(s1[g], s2[g]);
+			s0[g] = _mm256_xor_si256(s0[g], s3[g]);
+			s2[g] = _mm256_xor_si256(s2[g], t);
+			s3[g] = _mm256_or_si256(_mm256_slli_epi32(s3[g], 11), _mm256_srli_epi32(s3[g], 21));
+
+			// The die is the high half of result * num_vertices, multiplied in the even and the odd lanes. A low half in
+			// the biased region has the whole call replayed on the scalar kernel, which redraws the die.
+			__m256i even = _mm256_mul_epu32(result, range);
+			__m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(result, 32), range);
+			__m256i low = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+			__m256i die = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+			unbiased = _mm256_and_si256(unbiased, _mm256_cmpeq_epi32(_mm256_max_epu32(low, threshold), low));
+			__m256 vx = _mm256_i32gather_ps(params.vertex_x, die, 4);
+			__m256 vy = _mm256_i32gather_ps(params.vertex_y, die, 4);
+
+			x[g] = _mm256_add_ps(_mm256_mul_ps(x[g], keep), _mm256_mul_ps(vx, move));
+			y[g] = _mm256_add_ps(_mm256_mul_ps(y[g], keep), _mm256_mul_ps(vy, move));
+			_mm256_storeu_si256((__m256i *) (xs + step * SIMD_LANES + g * 8), _mm256_cvttps_epi32(x[g]));
+			_mm256_storeu_si256((__m256i *) (ys + step * SIMD_LANES + g * 8), _mm256_cvttps_epi32(y[g]));
+			if (vs != nullptr){
+				_mm256_storeu_si256((__m256i *) (vs + step * SIMD_LANES + g * 8), die);
+			}
+		}
+	}
+	for (int g = 0; g < GROUPS; g++){
+		_mm256_storeu_ps(lanes.x + g * 8, x[g]);
+		_mm256_storeu_ps(lanes.y + g * 8, y[g]);
+		_mm256_storeu_si256((__m256i *) (lanes.s0 + g * 8), s0[g]);
+		_mm256_storeu_si256((__m256i *) (lanes.s1 + g * 8), s1[g]);
+		_mm256_storeu_si256((__m256i *) (lanes.s2 + g * 8), s2[g]);
+		_mm256_storeu_si256((__m256i *) (lanes.s3 + g * 8), s3[g]);
+	}
+	if (_mm256_movemask_ps(_mm256_castsi256_ps(unbiased)) != 0xFF){
+		lanes = start;
+		simd_kernel_scalar(lanes, params, xs, ys, vs, steps);
+	}
+}
+
+// GCC warns about the deliberately undefined pass-through operands inside its own AVX-512 intrinsics
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+/**
+* AVX-512 kernel, all sixteen lanes in one register. AVX-512 brings FMA along, so multiplies and adds are kept
+* from fusing, as they are in the other kernels.
+*/
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+void simd_kernel_avx512(SimdLanes &lanes, const SimdParams &params, uint32_t *xs, uint32_t *ys, uint32_t *vs, size_t steps){
+	const __m512 keep = _mm512_set1_ps(1.0f - params.factor);
+	const __m512 move = _mm512_set1_ps(params.factor);
+	const __m512i range = _mm512_set1_epi32(params.num_vertices);
+	const __m512i threshold = _mm512_set1_epi32(params.die_threshold);
+	const SimdLanes start = lanes;
+	__mmask16 biased = 0;
+	__m512 x = _mm512_loadu_ps(lanes.x);
+	__m512 y = _mm512_loadu_ps(lanes.y);
+	__m512i s0 = _mm512_loadu_si512(lanes.s0);
+	__m512i s1 = _mm512_loadu_si512(lanes.s1);
+	__m512i s2 = _mm512_loadu_si512(lanes.s2);
+	__m512i s3 = _mm512_loadu_si512(lanes.s3);
+	for (size_t step = 0; step < steps; step++){
+		__m512i result = _mm512_add_epi32(s0, s3);
+		__m512i t = _mm512_slli_epi32(s1, 9);
+		s2 = _mm512_xor_si512(s2, s0);
+		s3 = _mm512_xor_si512(s3, s1);
+		s1 = _mm512_xor_si512(s1, s2);
+		s0 = _mm512_xor_si512(s0, s3);
+		s2 = _mm512_xor_si512(s2, t);
+		s3 = _mm512_rol_epi32(s3, 11);
+
+		// The die is the high half of result * num_vertices, multiplied in the even and the odd lanes. A low half in
+		// the biased region has the whole call replayed on the scalar kernel, which redraws the die.
+		__m512i even = _mm512_mul_epu32(result, range);
+		__m512i odd = _mm512_mul_epu32(_mm512_srli_epi64(result, 32), range);
+		__m512i low = _mm512_mask_blend_epi32(0xAAAA, even, _mm512_slli_epi64(odd, 32));
+		__m512i die = _mm512_mask_blend_epi32(0xAAAA, _mm512_srli_epi64(even, 32), odd);
+		biased |= _mm512_cmplt_epu32_mask(low, threshold);
+		__m512 vx = _mm512_i32gather_ps(die, params.vertex_x, 4);
+		__m512 vy = _mm512_i32gather_ps(die, params.vertex_y, 4);
+
+		x = _mm512_add_ps(_mm512_mul_ps(x, keep), _mm512_mul_ps(vx, move));
+		y = _mm512_add_ps(_mm512_mul_ps(y, keep), _mm512_mul_ps(vy, move));
+		_mm512_storeu_si512(xs + step * SIMD_LANES, _mm512_cvttps_epi32(x));
+		_mm512_storeu_si512(ys + step * SIMD_LANES, _mm512_cvttps_epi32(y));
+		if (vs != nullptr){
+			_mm512_storeu_si512(vs + step * SIMD_LANES, die);
+		}
+	}
+	_mm512_storeu_ps(lanes.x, x);
+	_mm512_storeu_ps(lanes.y, y);
+	_mm512_storeu_si512(lanes.s0, s0);
+	_mm512_storeu_si512(lanes.s1, s1);
+	_mm512_storeu_si512(lanes.s2, s2);
+	_mm512_storeu_si512(lanes.s3, s3);
+	if (biased != 0){
+		lanes = start;
+		simd_kernel_scalar(lanes, params, xs, ys, vs, steps);
+	}
+}
+
+#pragma GCC diagnostic pop
+
+#endif
+
+#if defined(__aarch64__)
+
+/**
+* NEON kernel, four groups of four lanes. NEON has no gather, so vertices are loaded one lane at a time.
+* Multiplies and adds are never fused, as they are not in the other kernels.
+*/
+__attribute__((optimize("fp-contract=off")))
+void simd_kernel_neon(SimdLanes &lanes, const SimdParams &params, uint32_t *xs, uint32_t *ys, uint32_t *vs, size_t steps){
+	const int GROUPS = SIMD_LANES / 4;
+	const float32x4_t keep = vdupq_n_f32(1.0f - params.factor);
+	const float32x4_t move = vdupq_n_f32(params.factor);
+	const uint32x4_t range = vdupq_n_u32(params.num_vertices);
+	const uint32x4_t threshold = vdupq_n_u32(params.die_threshold);
+	const SimdLanes start = lanes;
+	uint32x4_t biased = vdupq_n_u32(0);
+	float32x4_t x[GROUPS], y[GROUPS];
+	uint32x4_t s0[GROUPS], s1[GROUPS], s2[GROUPS], s3[GROUPS];
+	for (int g = 0; g < GROUPS; g++){
+		x[g] = vld1q_f32(lanes.x + g * 4);
+		y[g] = vld1q_f32(lanes.y + g * 4);
+		s0[g] = vld1q_u32(lanes.s0 + g * 4);
+		s1[g] = vld1q_u32(lanes.s1 + g * 4);
+		s2[g] = vld1q_u32(lanes.s2 + g * 4);
+		s3[g] = vld1q_u32(lanes.s3 + g * 4);
+	}
+	for (size_t step = 0; step < steps; step++){
+		for (int g = 0; g < GROUPS; g++){
+			uint32x4_t result = vaddq_u32(s0[g], s3[g]);
+			uint32x4_t t = vshlq_n_u32(s1[g], 9);
+			s2[g] = veorq_u32(s2[g], s0[g]);
+			s3[g] = veorq_u32(s3[g], s1[g]);
+			s1[g] = veorq_u32(s1[g], s2[g]);
+			s0[g] = veorq_u32(s0[g], s3[g]);
+			s2[g] = veorq_u32(s2[g], t);
+			s3[g] = vorrq_u32(vshlq_n_u32(s3[g], 11), vshrq_n_u32(s3[g], 21));
+
+			// The die is the high half of result * num_vertices, multiplied in the low and the high lanes. A low half in
+			// the biased region has the whole call replayed on the scalar kernel, which redraws the die.
+			uint32_t die[4];
+			uint64x2_t first = vmull_u32(vget_low_u32(result), vget_low_u32(range));
+			uint64x2_t second = vmull_u32(vget_high_u32(result), vget_high_u32(range));
+			uint32x4_t low = vmulq_u32(result, range);
+			vst1q_u32(die, vcombine_u32(vshrn_n_u64(first, 32), vshrn_n_u64(second, 32)));
+			biased = vorrq_u32(biased, vcltq_u32(low, threshold));
+			float vx_lanes[4] = {params.vertex_x[die[0]], params.vertex_x[die[1]], params.vertex_x[die[2]], params.vertex_x[die[3]]};
+			float vy_lanes[4] = {params.vertex_y[die[0]], params.vertex_y[die[1]], params.vertex_y[die[2]], params.vertex_y[die[3]]};
+			float32x4_t vx = vld1q_f32(vx_lanes);
+			float32x4_t vy = vld1q_f32(vy_lanes);
+
+			x[g] = vaddq_f32(vmulq_f32(x[g], keep), vmulq_f32(vx, move));
+			y[g] = vaddq_f32(vmulq_f32(y[g], keep), vmulq_f32(vy, move));
+			vst1q_u32(xs + step * SIMD_LANES + g * 4, vcvtq_u32_f32(x[g]));
+			vst1q_u32(ys + step * SIMD_LANES + g * 4, vcvtq_u32_f32(y[g]));
+			if (vs != nullptr){
+				vst1q_u32(vs + step * SIMD_LANES + g * 4, vld1q_u32(die));
+			}
+		}
+	}
+	for (int g = 0; g < GROUPS; g++){
+		vst1q_f32(lanes.x + g * 4, x[g]);
+		vst1q_f32(lanes.y + g * 4, y[g]);
+		vst1q_u32(lanes.s0 + g * 4, s0[g]);
+		vst1q_u32(lanes.s1 + g * 4, s1[g]);
+		vst1q_u32(lanes.s2 + g * 4, s2[g]);
+		vst1q_u32(lanes.s3 + g * 4, s3[g]);
+	}
+	if (vmaxvq_u32(biased) != 0){
+		lanes = start;
+		simd_kernel_scalar(lanes, params, xs, ys, vs, steps);
+	}
+}
+
+#endif
+
+/**
+* Returns the SIMD kernel for an instruction set, or the scalar kernel of the lanes kernel, or nullptr if this CPU
+* or build does not support it.
+*/
+SimdKernel find_simd_kernel(KernelKind kind){
+	switch (kind){
+#if defined(__x86_64__) || defined(__i386__)
+		case KERNEL_SSE4:
+			return __builtin_cpu_supports("sse4.1") ? simd_kernel_sse4 : nullptr;
+		case KERNEL_AVX2:
+			return __builtin_cpu_supports("avx2") ? simd_kernel_avx2 : nullptr;
+		case KERNEL_AVX512:
+			return __builtin_cpu_supports("avx512f") ? simd_kernel_avx512 : nullptr;
+#endif
+#if defined(__aarch64__)
+		case KERNEL_NEON:
+			return simd_kernel_neon;
+#endif
+		case KERNEL_LANES:
+			return simd_kernel_scalar;
+		default:
+			return nullptr;
+	}
+}
+
+/**
+* Returns the widest instruction set with a SIMD kernel on this CPU, or KERNEL_SCALAR if there is none.
+*/
+KernelKind best_simd_kernel(){
+	const KernelKind preferred[] = {KERNEL_AVX512, KERNEL_AVX2, KERNEL_SSE4, KERNEL_NEON};
+	for (int i = 0; i < 4; i++){
+		if (find_simd_kernel(preferred[i]) != nullptr){
+			return preferred[i];
+		}
+	}
+	return KERNEL_SCALAR;
+}
+
+/**
+* Returns the kernel a checkpoint records for kind: the SIMD kernels all draw the points of the lanes kernel, from
+* the same walker lanes, so checkpoints record them all as lanes and resume on whichever this CPU runs best.
+*/
+KernelKind logical_kernel(KernelKind kind){
+	return kind == KERNEL_SCALAR || kind == KERNEL_FIXED ? kind : KERNEL_LANES;
+}
+
+const char *RNG_NAMES[] = {"xoshiro256", "pcg32", "splitmix"};
+
+const uint64_t IFS_BURN_IN = 1000;
+
+// Number of iterations a walker runs between checks of whether the game goes on
+const uint64_t WALKER_BATCH = 65536;
+
+// Most points a walker publishes before the caller takes them
+const uint64_t PENDING_POINTS = 1 << 20;
+
+// Number of steps a SIMD kernel runs per call, and between checks of whether the game goes on
+const size_t SIMD_CHUNK = 256;
+
+std::atomic<bool> flag_interrupted(false);
+
+Game::Game() : render_width(0), render_height(0), supersample(1), num_vertices(0), factor(0), factor_q32(0),
+	flag_ifs(false), view_width(0), view_height(0), flag_zoomed(false), view_center_x(0), view_center_y(0), view_zoom(1),
+	view_x0(0), view_y0(0), view_scale(1), flag_density(false), tone_kind(TONE_LOG), gamma_value(2.2), density_tiles_x(0),
+	flag_tiled(false), tile_memory(0), tile_fd(-1), tiles_x(0), tiles_y(0), tile_bytes(0), tile_evictions(0), stepping(1),
+	num_iterations(0), flag_stream(false), flag_stream_all(false), stream_format(STREAM_RAW), stream_fd(-1), num_threads(0),
+	rng_kind(RNG_XOSHIRO256), seed(0), kernel_kind(KERNEL_SCALAR), simd_kernel(nullptr), burn_in(0), flag_burn_in_set(false),
+	die_threshold(0), walker_loop(nullptr), flag_continue(false), flag_pause(false), walkers_paused(0), recording(RECORD_NONE),
+	iterations(0){
+	std::fill(ifs_frame, ifs_frame + 4, 0.0f);
+}
+
+Game::~Game(){
+	teardown();
+}
+
+/**
+* Ends the game: stops its walkers, waits for the snapshot being written, and closes the tile file and the point
+* stream. The grid and the walkers are kept, for the next game to reuse or release.
+*/
+void Game::teardown(){
+	stop();
+	if (checkpoint_writer.joinable()){
+		checkpoint_writer.join();
+	}
+	close_tile_store();
+	close_stream();
+}
+
+/**
+* Runs every walker continuously in simulate, on a thread of its own.
+*/
+void Game::start(){
+	for (size_t t = 0; t < walkers.size(); t++){
+		publish_points(walkers[t]);
+	}
+	for (size_t t = 0; t < walkers.size(); t++){
+		threads.push_back(std::thread(&Game::simulate, this, std::ref(walkers[t])));
+	}
+}
+
+/**
+* Stops the game, and waits for the walkers running in simulate to finish their step.
+*/
+void Game::stop(){
+	flag_continue = false;
+	for (size_t t = 0; t < threads.size(); t++){
+		threads[t].join();
+	}
+	threads.clear();
+}
+
+/**
+* Marks the pixel at (x, y) of the zoomed view in view_occupancy.
+* @return true if the pixel was not marked before.
+*/
+inline bool Game::mark_view_point(uint32_t x, uint32_t y){
+	uint64_t index = uint64_t (y) * view_width + x;
+	std::atomic<uint64_t> &word = view_occupancy[index >> 6];
+	uint64_t mask = uint64_t (1) << (index & 63);
+	if (word.load(std::memory_order_relaxed) & mask){
+		return false;
+	}
+	return (word.fetch_or(mask, std::memory_order_relaxed) & mask) == 0;
+}
+
+/**
+* Marks the cell at (x, y) in the occupancy grid.
+* @return true if the cell was not marked before.
+*/
+inline bool Game::mark_point(uint32_t x, uint32_t y){
+	return mark_index(uint64_t (y) * render_width + x);
+}
+
+/**
+* Counts a hit on the cell at (x, y) in the density buffer. Counts saturate instead of wrapping.
+* A single walker owns the buffer, so it skips the locked increment.
+* @return true if the cell had no hits before.
+*/
+inline bool Game::add_hit(uint32_t x, uint32_t y){
+	std::atomic<DensityCount> &count = density[density_index(x, y)];
+	DensityCount old = count.load(std::memory_order_relaxed);
+	if (old == DENSITY_MAX){
+		return false;
+	}
+	if (num_threads == 1){
+		count.store(old + 1, std::memory_order_relaxed);
+		return old == 0;
+	}
+	old = count.fetch_add(1, std::memory_order_relaxed);
+	// Another walker reached the maximum since the load, undo the wrap
+	if (old == DENSITY_MAX){
+		count.store(DENSITY_MAX, std::memory_order_relaxed);
+	}
+	return old == 0;
+}
+
+/**
+* Creates the tile file, sized for the render grid, with every cell unmarked.
+* The file is sparse, so tiles that are never hit take no space.
+* @return true if the file was created successfully.
+*/
+bool Game::open_tile_store(){
+	tiles_x = (render_width + TILE_MASK) >> TILE_SHIFT;
+	tiles_y = (render_height + TILE_MASK) >> TILE_SHIFT;
+	tile_bytes = (size_t (1) << (2 * TILE_SHIFT)) * (flag_density ? sizeof(DensityCount) : 1) / (flag_density ? 1 : 8);
+	tile_fd = open(tile_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (tile_fd < 0 || ftruncate(tile_fd, off_t (tiles_x) * tiles_y * tile_bytes) != 0){
+		return false;
+	}
+	tile_maps.assign(size_t (tiles_x) * tiles_y, nullptr);
+	tile_lru.clear();
+	tile_lru_pos.assign(tile_maps.size(), tile_lru.end());
+	return true;
+}
+
+/**
+* Unmaps every tile and closes the tile file. The file is kept, it holds the finished grid.
+*/
+void Game::close_tile_store(){
+	for (size_t t = 0; t < tile_maps.size(); t++){
+		if (tile_maps[t] != nullptr){
+			munmap(tile_maps[t], tile_bytes);
+		}
+	}
+	tile_maps.clear();
+	tile_lru.clear();
+	if (tile_fd >= 0){
+		close(tile_fd);
+		tile_fd = -1;
+	}
+}
+
+/**
+* Returns the mapping of a tile, mapping it first if it is not resident. When tile_memory is used up,
+* the least recently used tile is unmapped, and the kernel writes it back to the file.
+* The caller holds tile_mutex. Mappings stay valid until tile_evictions changes.
+*/
+uint8_t *Game::acquire_tile(uint32_t tile){
+	if (tile_maps[tile] != nullptr){
+		tile_lru.splice(tile_lru.begin(), tile_lru, tile_lru_pos[tile]);
+		return tile_maps[tile];
+	}
+	if (!tile_lru.empty() && (tile_lru.size() + 1) * tile_bytes > tile_memory){
+		uint32_t oldest = tile_lru.back();
+		tile_lru.pop_back();
+		munmap(tile_maps[oldest], tile_bytes);
+		tile_maps[oldest] = nullptr;
+		tile_evictions++;
+	}
+	void *map = mmap(nullptr, tile_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, tile_fd, off_t (tile) * tile_bytes);
+	if (map == MAP_FAILED){
+		std::cerr << "Could not map tile " << tile << " of " << tile_path << "." << std::endl;
+		std::abort();
+	}
+	tile_maps[tile] = static_cast<uint8_t *>(map);
+	tile_lru.push_front(tile);
+	tile_lru_pos[tile] = tile_lru.begin();
+	return tile_maps[tile];
+}
+
+/**
+* Tile a reader of the tile file mapped last, so that consecutive cells of the same tile reuse its mapping.
+* Each reader keeps its own, which is only valid while it holds tile_mutex, so it never outlives an eviction
+* by another thread or a reopened store.
+*/
+struct TileCursor {
+	uint32_t tile;
+	uint64_t evictions;
+	uint8_t *data;
+};
+
+/**
+* Returns the hit count of the cell at (x, y) in the tile file, or 1 for a marked cell.
+* Only used once the walkers are done. The caller holds tile_mutex.
+* @param cursor: The caller's last tile, remapped when the cell is in another tile or a tile was unmapped since
+*/
+inline uint32_t Game::tiled_cell(TileCursor &cursor, uint32_t x, uint32_t y){
+	uint32_t wanted = (y >> TILE_SHIFT) * tiles_x + (x >> TILE_SHIFT);
+	if (wanted != cursor.tile || cursor.evictions != tile_evictions || cursor.data == nullptr){
+		cursor.tile = wanted;
+		cursor.data = acquire_tile(wanted);
+		cursor.evictions = tile_evictions;
+	}
+	uint32_t offset = (y & TILE_MASK) << TILE_SHIFT | (x & TILE_MASK);
+	if (flag_density){
+		return reinterpret_cast<DensityCount *>(cursor.data)[offset];
+	}
+	return (cursor.data[offset >> 3] >> (offset & 7)) & 1;
+}
+
+/**
+* Applies a walker's binned points to the tile file. The points are grouped by tile with a counting sort,
+* so each resident tile is updated sequentially and mapped at most once per flush.
+*/
+void Game::flush_bin(Walker &walker){
+	if (walker.bin.empty()){
+		return;
+	}
+	std::vector<uint32_t> &starts = walker.tile_starts;
+	starts.assign(tile_maps.size() + 1, 0);
+	for (size_t i = 0; i < walker.bin.size(); i++){
+		starts[(walker.bin[i] >> (2 * TILE_SHIFT)) + 1]++;
+	}
+	for (size_t t = 1; t < starts.size(); t++){
+		starts[t] += starts[t - 1];
+	}
+	walker.sorted_bin.resize(walker.bin.size());
+	for (size_t i = 0; i < walker.bin.size(); i++){
+		walker.sorted_bin[starts[walker.bin[i] >> (2 * TILE_SHIFT)]++] = walker.bin[i];
+	}
+	walker.bin.clear();
+
+	std::lock_guard<std::mutex> lock(tile_mutex);
+	uint32_t tile = UINT32_MAX;
+	uint8_t *data = nullptr;
+	for (size_t i = 0; i < walker.sorted_bin.size(); i++){
+		uint64_t key = walker.sorted_bin[i];
+		if ((key >> (2 * TILE_SHIFT)) != tile){
+			tile = key >> (2 * TILE_SHIFT);
+			data = acquire_tile(tile);
+		}
+		uint32_t offset = key & ((1 << (2 * TILE_SHIFT)) - 1);
+		if (flag_density){
+			DensityCount &count = reinterpret_cast<DensityCount *>(data)[offset];
+			walker.num_points += count == 0;
+			count += count != DENSITY_MAX;
+		}
+		else if (!((data[offset >> 3] >> (offset & 7)) & 1)){
+			data[offset >> 3] |= 1 << (offset & 7);
+			walker.num_points++;
+		}
+	}
+}
+
+/**
+* Bins a point for the tile file, flushing the walker's bin when it is full.
+*/
+inline void Game::bin_point(Walker &walker, uint32_t x, uint32_t y){
+	uint64_t tile = (y >> TILE_SHIFT) * tiles_x + (x >> TILE_SHIFT);
+	walker.bin.push_back(tile << (2 * TILE_SHIFT) | (y & TILE_MASK) << TILE_SHIFT | (x & TILE_MASK));
+	if (walker.bin.size() >= TILE_BIN_POINTS){
+		flush_bin(walker);
+	}
+}
+
+/**
+* Plots a point generated by a walker, into the density buffer or the occupancy grid, or bins it
+* for the tile file in tiled mode, where new points are only counted when the bin is flushed.
+* Always inlined, as the many specialized loops would otherwise exceed the inliner's growth limits.
+* @return true if this is the first time the cell is hit.
+*/
+__attribute__((always_inline))
+inline bool Game::plot_point(Walker &walker, uint32_t x, uint32_t y){
+	// The resident bit grid is the common case, keep it on the straight path of the loops
+	if (__builtin_expect(flag_tiled, 0)){
+		bin_point(walker, x, y);
+		return false;
+	}
+	return __builtin_expect(flag_density, 0) ? add_hit(x, y) : mark_point(x, y);
+}
+
+/**
+* Converts a coordinate to Q32.32. Every float below 2^32 with no bits under 2^-32 converts exactly,
+* which includes all points on the grid.
+*/
+inline uint64_t to_q32(float value){
+	return uint64_t (double (value) * 4294967296.0);
+}
+
+/**
+* Converts a Q32.32 coordinate back to the nearest float.
+*/
+inline float from_q32(uint64_t value){
+	return float (double (value) / 4294967296.0);
+}
+
+/**
+* Fills the SoA copies of the vertex coordinates, for the SIMD kernels, and their fixed-point copies,
+* along with the Q32.32 fraction of the fixed kernel. The fixed kernel moves towards the vertices rounded to
+* whole cells, so that the last bits of cos and sin, which differ between math libraries, never reach its points.
+*/
+void Game::fill_vertex_arrays(){
+	vertex_x.resize(num_vertices);
+	vertex_y.resize(num_vertices);
+	vertex_fixed_x.resize(num_vertices);
+	vertex_fixed_y.resize(num_vertices);
+	vertex_q32_x.resize(num_vertices);
+	vertex_q32_y.resize(num_vertices);
+	for (int i = 0; i < num_vertices; i++){
+		vertex_x[i] = vertices[i].x;
+		vertex_y[i] = vertices[i].y;
+		vertex_fixed_x[i] = uint64_t (vertices[i].x * (1 << FIXED_SHIFT) + 0.5f);
+		vertex_fixed_y[i] = uint64_t (vertices[i].y * (1 << FIXED_SHIFT) + 0.5f);
+		vertex_q32_x[i] = uint64_t (std::lround(vertices[i].x)) << Q32_SHIFT;
+		vertex_q32_y[i] = uint64_t (std::lround(vertices[i].y)) << Q32_SHIFT;
+	}
+	factor_q32 = uint64_t (std::llround(double (factor) * 4294967296.0));
+}
+
+/**
+* Returns a map given in coordinates of ifs_frame, where y grows upwards, as a map in render space,
+* where y grows downwards. With the grid point p = S q + o of the frame point q, the map becomes
+* S A S^-1 p + S t + o - S A S^-1 o.
+*/
+AffineMap Game::frame_to_render(const AffineMap &map){
+	double sx = render_width / double (ifs_frame[2] - ifs_frame[0]);
+	double sy = -double (render_height) / double (ifs_frame[3] - ifs_frame[1]);
+	double ox = -ifs_frame[0] * sx, oy = -ifs_frame[3] * sy;
+	double a = map.a, b = map.b * sx / sy, c = map.c * sy / sx, d = map.d;
+	return AffineMap {float (a), float (b), float (c), float (d),
+		float (sx * map.e + ox - (a * ox + b * oy)), float (sy * map.f + oy - (c * ox + d * oy))};
+}
+
+/**
+* Returns the fixed point of a map in render space, clamped to the grid, or its translation if it has none.
+*/
+Vertex Game::fixed_point(const AffineMap &map){
+	double det = (1.0 - map.a) * (1.0 - map.d) - double (map.b) * map.c;
+	double x = map.e, y = map.f;
+	if (std::fabs(det) > 1e-9){
+		x = ((1.0 - map.d) * map.e + map.b * map.f) / det;
+		y = ((1.0 - map.a) * map.f + map.c * map.e) / det;
+	}
+	return Vertex {float (std::min(std::max(x, 0.0), render_width - 1.0)), float (std::min(std::max(y, 0.0), render_height - 1.0))};
+}
+
+/**
+* Creates the maps given in frame coordinates in render space, and their fixed points as the vertices.
+*/
+void Game::create_file_vertices(){
+	num_vertices = ifs_file_maps.size();
+	ifs_maps.resize(num_vertices);
+	vertices.resize(num_vertices);
+	for (uint16_t v = 0; v < num_vertices; v++){
+		ifs_maps[v] = frame_to_render(ifs_file_maps[v]);
+		vertices[v] = fixed_point(ifs_maps[v]);
+	}
+	fill_vertex_arrays();
+}
+
+/**
+* Creates the vertices of the polygon, evenly spaced around the centre of the render grid.
+*/
+void Game::create_vertices(){
+	if (!ifs_file_maps.empty()){
+		create_file_vertices();
+		return;
+	}
+	vertices.resize(num_vertices);
+	float theta;
+	for (int i = 0; i < num_vertices; i++){
+		theta = 270 + float (i * 360) / float (num_vertices);
+		vertices[i].x = render_width/2 + cos(theta*M_PI/180) * (render_width * (1.0 - SCREEN_MARGINS) / 2);
+		vertices[i].y = render_height/2 + sin(theta*M_PI/180) * (render_height * (1.0 - SCREEN_MARGINS) / 2);
+	}
+
+	fill_vertex_arrays();
+}
+
+/**
+* Fills one alias table with Vose's method, for the probabilities in proportion to weights.
+* Column i is kept when the coin is below threshold[i], and replaced by other[i] otherwise.
+*/
+void build_alias_table(const std::vector<double> &weights, uint32_t *threshold, uint32_t *other){
+	size_t n = weights.size();
+	double total = 0;
+	for (size_t i = 0; i < n; i++){
+		total += weights[i];
+	}
+	std::vector<double> scaled(n);
+	std::vector<uint32_t> small, large;
+	for (size_t i = 0; i < n; i++){
+		scaled[i] = weights[i] * n / total;
+		(scaled[i] < 1.0 ? small : large).push_back(i);
+	}
+	while (!small.empty() && !large.empty()){
+		uint32_t less = small.back(), more = large.back();
+		small.pop_back();
+		threshold[less] = uint32_t (std::min(scaled[less] * 4294967296.0, 4294967295.0));
+		other[less] = more;
+		scaled[more] -= 1.0 - scaled[less];
+		if (scaled[more] < 1.0){
+			large.pop_back();
+			small.push_back(more);
+		}
+	}
+	// What is left has a probability of 1 up to rounding, and is its own alias so the coin does not matter
+	large.insert(large.end(), small.begin(), small.end());
+	for (size_t i = 0; i < large.size(); i++){
+		threshold[large[i]] = UINT32_MAX;
+		other[large[i]] = large[i];
+	}
+}
+
+/**
+* Creates the maps of the polygon's vertices, unless maps were given, and the alias table of every
+* previous vertex from the weights and restrictions. Weights that do not match the number of vertices are
+* ignored, and a previous vertex whose restrictions leave nothing to choose allows every vertex.
+*/
+void Game::create_ifs(){
+	uint32_t n = num_vertices;
+	if (ifs_file_maps.empty()){
+		ifs_maps.resize(n);
+		for (uint32_t v = 0; v < n; v++){
+			ifs_maps[v] = AffineMap {1.0f - factor, 0.0f, 0.0f, 1.0f - factor, factor * vertex_x[v], factor * vertex_y[v]};
+		}
+	}
+	std::vector<double> weights(n, 1.0);
+	if (ifs_weights.size() == n){
+		weights.assign(ifs_weights.begin(), ifs_weights.end());
+	}
+	alias_threshold.resize(n * n);
+	alias_other.resize(n * n);
+	for (uint32_t previous = 0; previous < n; previous++){
+		std::vector<double> allowed(weights);
+		for (size_t r = 0; r < ifs_restrict.size(); r++){
+			allowed[(previous + ifs_restrict[r]) % n] = 0;
+		}
+		if (*std::max_element(allowed.begin(), allowed.end()) <= 0){
+			allowed = weights;
+		}
+		build_alias_table(allowed, &alias_threshold[previous * n], &alias_other[previous * n]);
+	}
+}
+
+/**
+* Parses a whole string as a finite number, unlike atof, which reads "x" or "1x" as a number.
+* @param text: Number to parse, with nothing before or after it
+* @param value: Set to the number if it is valid
+* @return false if the text is empty, not a number, or has trailing characters.
+*/
+bool parse_number(const std::string &text, double &value){
+	if (text.empty()){
+		return false;
+	}
+	char *end;
+	errno = 0;
+	double parsed = std::strtod(text.c_str(), &end);
+	if (*end != '\0' || errno == ERANGE || !std::isfinite(parsed)){
+		return false;
+	}
+	value = parsed;
+	return true;
+}
+
+/**
+* Reads the maps of an IFS from a file, one map per line as "weight a b c d e f" for the map
+* (x, y) -> (a x + b y + e, c x + d y + f), with an optional line "frame x0 y0 x1 y1" giving the region
+* of the plane that is rendered, y growing upwards. Text after # is ignored.
+* @return true if between 1 and 255 maps with a positive total weight were read, in which case file_maps,
+* file_weights and file_frame are set.
+*/
+bool read_ifs_file(const std::string &path, std::vector<AffineMap> &file_maps, std::vector<float> &file_weights, float file_frame[4]){
+	std::ifstream file(path);
+	if (!file){
+		return false;
+	}
+	std::vector<AffineMap> maps;
+	std::vector<float> weights;
+	float frame[4] = {0, 0, 1, 1};
+	double total = 0;
+	std::string line;
+	while (std::getline(file, line)){
+		line = line.substr(0, line.find('#'));
+		std::stringstream ss(line);
+		std::string first;
+		if (!(ss >> first)){
+			continue;
+		}
+		std::vector<double> values;
+		std::string token;
+		double value;
+		while (ss >> token){
+			if (!parse_number(token, value)){
+				return false;
+			}
+			values.push_back(value);
+		}
+		if (first == "frame"){
+			if (values.size() != 4 || values[2] <= values[0] || values[3] <= values[1]){
+				return false;
+			}
+			std::copy(values.begin(), values.end(), frame);
+			continue;
+		}
+		double weight;
+		if (!parse_number(first, weight) || weight < 0 || values.size() != 6){
+			return false;
+		}
+		AffineMap map = {float (values[0]), float (values[1]), float (values[2]), float (values[3]), float (values[4]), float (values[5])};
+		maps.push_back(map);
+		weights.push_back(weight);
+		total += weight;
+	}
+	if (maps.empty() || maps.size() > 255 || total <= 0){
+		return false;
+	}
+	file_maps = maps;
+	file_weights = weights;
+	std::copy(frame, frame + 4, file_frame);
+	return true;
+}
+
+/**
+* Records a point newly discovered by a walker.
+*/
+inline void record_point(Walker &walker, uint32_t x, uint32_t y, Recording recording){
+	walker.num_points++;
+	if (recording == RECORD_POINTS){
+		walker.new_points.push_back(Point {x, y});
+	}
+}
+
+/**
+* Writes a whole buffer to the stream. On failure, such as the reader closing the pipe, the game stops.
+*/
+bool Game::write_stream(const uint8_t *data, size_t size){
+	while (size > 0){
+		ssize_t written = write(stream_fd, data, size);
+		if (written < 0){
+			if (errno == EINTR){
+				continue;
+			}
+			std::cerr << "Could not write to the point stream, stopping." << std::endl;
+			flag_continue = false;
+			flag_stream = false;
+			return false;
+		}
+		data += written;
+		size -= written;
+	}
+	return true;
+}
+
+/**
+* Opens the point stream and writes its header: magic, version, record format, render size and number of vertices.
+* @return true if the stream was opened successfully.
+*/
+bool Game::open_stream(){
+	stream_fd = stream_path == "-" ? STDOUT_FILENO : open(stream_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (stream_fd < 0){
+		return false;
+	}
+	// A closed reader is reported by write_stream instead of killing the process
+	signal(SIGPIPE, SIG_IGN);
+	std::vector<uint8_t> header(STREAM_MAGIC, STREAM_MAGIC + sizeof(STREAM_MAGIC));
+	uint8_t format = stream_format;
+	const uint8_t *fields[] = {reinterpret_cast<const uint8_t *>(&STREAM_VERSION), &format,
+		reinterpret_cast<const uint8_t *>(&render_width), reinterpret_cast<const uint8_t *>(&render_height),
+		reinterpret_cast<const uint8_t *>(&num_vertices)};
+	const size_t sizes[] = {sizeof(STREAM_VERSION), sizeof(format), sizeof(render_width), sizeof(render_height), sizeof(num_vertices)};
+	for (int i = 0; i < 5; i++){
+		header.insert(header.end(), fields[i], fields[i] + sizes[i]);
+	}
+	return write_stream(header.data(), header.size());
+}
+
+/**
+* Closes the point stream, unless it is stdout.
+*/
+void Game::close_stream(){
+	if (stream_fd >= 0 && stream_fd != STDOUT_FILENO){
+		close(stream_fd);
+	}
+	stream_fd = -1;
+}
+
+/**
+* Appends a 32-bit value to a stream buffer, in native byte order.
+*/
+inline void put_u32(std::vector<uint8_t> &out, uint32_t value){
+	const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+	out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+/**
+* Writes a walker's buffered records to the stream as one chunk: walker index, number of records and
+* size in bytes of the records, followed by the records. Chunks of different walkers interleave,
+* but a chunk is always written whole.
+*/
+__attribute__((noinline))
+void Game::flush_stream(Walker &walker){
+	if (walker.stream_records == 0){
+		return;
+	}
+	std::vector<uint8_t> &buffer = walker.stream_buffer;
+	uint32_t header[3] = {walker.index, walker.stream_records, uint32_t (buffer.size() - sizeof(header))};
+	std::memcpy(&buffer[0], header, sizeof(header));
+	{
+		std::lock_guard<std::mutex> lock(stream_mutex);
+		if (flag_stream){
+			write_stream(buffer.data(), buffer.size());
+		}
+	}
+	buffer.resize(sizeof(header));
+	walker.stream_records = 0;
+	walker.stream_x = 0;
+	walker.stream_y = 0;
+}
+
+/**
+* Appends a zigzag varint, which keeps small negative deltas short.
+*/
+inline void put_zigzag(std::vector<uint8_t> &out, int64_t value){
+	uint64_t zigzag = (uint64_t (value) << 1) ^ uint64_t (value >> 63);
+	while (zigzag >= 0x80){
+		out.push_back(uint8_t (zigzag) | 0x80);
+		zigzag >>= 7;
+	}
+	out.push_back(uint8_t (zigzag));
+}
+
+/**
+* Buffers a record for the stream, flushing the walker's chunk when it is full.
+* Raw records are 4 bytes x, 4 bytes y and 1 byte vertex. Varint records are the zigzag deltas
+* of x and y from the previous record of the chunk, and the vertex as a varint.
+*/
+inline void Game::stream_point(Walker &walker, uint32_t x, uint32_t y, uint32_t vertex){
+	std::vector<uint8_t> &buffer = walker.stream_buffer;
+	if (stream_format == STREAM_RAW){
+		put_u32(buffer, x);
+		put_u32(buffer, y);
+		buffer.push_back(uint8_t (vertex));
+	}
+	else{
+		put_zigzag(buffer, int64_t (x) - walker.stream_x);
+		put_zigzag(buffer, int64_t (y) - walker.stream_y);
+		put_zigzag(buffer, vertex);
+		walker.stream_x = x;
+		walker.stream_y = y;
+	}
+	walker.stream_records++;
+	if (buffer.size() >= STREAM_BUFFER){
+		flush_stream(walker);
+	}
+}
+
+/**
+* Moves the point (x, y) towards the vertex (vx, vy) by the fraction move, keeping keep = 1 - move of the point.
+* The point keeps its fractional part, it is only truncated to a cell when plotted.
+*/
+inline void next_point(float &x, float &y, float vx, float vy, float keep, float move){
+	x = x * keep + vx * move;
+	y = y * keep + vy * move;
+}
+
+/**
+* Moves the fixed-point (x, y) halfway towards the fixed-point vertex (vx, vy).
+*/
+inline void next_point_half(uint64_t &x, uint64_t &y, uint64_t vx, uint64_t vy){
+	x = (x + vx) >> 1;
+	y = (y + vy) >> 1;
+}
+
+/**
+* Moves the Q32.32 point (x, y) towards the Q32.32 vertex (vx, vy) by the Q32.32 fraction move,
+* x + (vx - x) move, rounded to nearest. The product is exact in 128 bits, so this is one multiply,
+* an add and a shift per coordinate.
+*/
+inline void next_point_q32(uint64_t &x, uint64_t &y, uint64_t vx, uint64_t vy, uint64_t move){
+	typedef __int128 Wide;
+	const Wide half = Wide (1) << (Q32_SHIFT - 1);
+	x += uint64_t ((Wide (int64_t (vx - x)) * Wide (move) + half) >> Q32_SHIFT);
+	y += uint64_t ((Wide (int64_t (vy - y)) * Wide (move) + half) >> Q32_SHIFT);
+}
+
+/**
+* Returns a walker's generator of the given kind.
+*/
+template <class Rng> Rng &walker_rng(Walker &walker);
+template <> Xoshiro256 &walker_rng<Xoshiro256>(Walker &walker){ return walker.xoshiro; }
+template <> Pcg32 &walker_rng<Pcg32>(Walker &walker){ return walker.pcg; }
+template <> SplitMix64 &walker_rng<SplitMix64>(Walker &walker){ return walker.splitmix; }
+
+/**
+* Applies an affine map to (x, y).
+*/
+inline void apply_map(const AffineMap &map, float &x, float &y){
+	float next_x = map.a * x + map.b * y + map.e;
+	y = map.c * x + map.d * y + map.f;
+	x = next_x;
+}
+
+/**
+* Places a walker on a random first point, using its own generator.
+*/
+template <class Rng>
+void Game::place_walker(Walker &walker, Rng &rng){
+	walker.x = uniform_below(rng, render_width);
+	walker.y = uniform_below(rng, render_height);
+
+	// Lanes of the SIMD kernels get their own first points and xoshiro128+ states.
+	// A lane state must not be all zero, so s0 is forced odd.
+	for (int lane = 0; lane < SIMD_LANES; lane++){
+		walker.lanes.x[lane] = uniform_below(rng, render_width);
+		walker.lanes.y[lane] = uniform_below(rng, render_height);
+		walker.lanes.s0[lane] = rng.next_u32() | 1;
+		walker.lanes.s1[lane] = rng.next_u32();
+		walker.lanes.s2[lane] = rng.next_u32();
+		walker.lanes.s3[lane] = rng.next_u32();
+	}
+}
+
+/**
+* Advances a walker's point a number of iterations with its generator Rng, without plotting them,
+* by the IFS rules in IFS mode, and in Q32.32 with the fixed kernel.
+*/
+template <class Rng>
+void Game::warm_up_point(Walker &walker, uint64_t iterations){
+	Rng &rng = walker_rng<Rng>(walker);
+	if (flag_ifs){
+		for (uint64_t i = 0; i < iterations; i++){
+			walker.vertex = choose_vertex(rng.next_u32(), num_vertices, walker.vertex, alias_threshold.data(), alias_other.data());
+			apply_map(ifs_maps[walker.vertex], walker.x, walker.y);
+		}
+		return;
+	}
+	if (kernel_kind == KERNEL_FIXED){
+		for (uint64_t i = 0; i < iterations; i++){
+			uint32_t vertex = uniform_below(rng, num_vertices, die_threshold);
+			next_point_q32(walker.fixed_x, walker.fixed_y, vertex_q32_x[vertex], vertex_q32_y[vertex], factor_q32);
+		}
+		walker.x = from_q32(walker.fixed_x);
+		walker.y = from_q32(walker.fixed_y);
+		return;
+	}
+	const float keep = 1.0f - factor, move = factor;
+	for (uint64_t i = 0; i < iterations; i++){
+		uint32_t vertex = uniform_below(rng, num_vertices, die_threshold);
+		next_point(walker.x, walker.y, vertex_x[vertex], vertex_y[vertex], keep, move);
+	}
+}
+
+/**
+* Runs a walker burn_in iterations without plotting them: all of its SIMD lanes at once in chunks
+* when a SIMD kernel is selected, its point otherwise.
+*/
+void Game::warm_up_walker(Walker &walker){
+	if (simd_kernel != nullptr){
+		SimdParams params = {vertex_x.data(), vertex_y.data(), num_vertices, factor, die_threshold};
+		uint32_t xs[SIMD_CHUNK * SIMD_LANES], ys[SIMD_CHUNK * SIMD_LANES];
+		for (uint64_t step = 0; step < burn_in; step += SIMD_CHUNK){
+			simd_kernel(walker.lanes, params, xs, ys, nullptr, std::min(uint64_t (SIMD_CHUNK), burn_in - step));
+		}
+		return;
+	}
+	switch (rng_kind){
+		case RNG_XOSHIRO256:
+			warm_up_point<Xoshiro256>(walker, burn_in);
+			break;
+		case RNG_PCG32:
+			warm_up_point<Pcg32>(walker, burn_in);
+			break;
+		case RNG_SPLITMIX:
+			warm_up_point<SplitMix64>(walker, burn_in);
+			break;
+	}
+}
+
+/**
+* Returns the number of points a walker's pending buffer holds: a share of the render grid, every cell being
+* discovered once, but at least a step and at most PENDING_POINTS.
+*/
+uint64_t Game::pending_points(){
+	uint64_t share = uint64_t (render_width) * render_height / num_threads + 1;
+	return std::max(stepping + 1, std::min(share, PENDING_POINTS));
+}
+
+/**
+* Creates one walker per thread, each seeded with its own stream and placed on a random first point,
+* then runs the burn-in of every walker on its own thread. Without a burn-in the first points are recorded.
+* Walkers recording points reserve their buffers in the arena. The first points are recorded as set by recording.
+*/
+void Game::create_walkers(){
+	die_threshold = (0u - num_vertices) % num_vertices;
+	std::vector<Walker>(num_threads).swap(walkers);
+	for (uint16_t t = 0; t < num_threads; t++){
+		switch (rng_kind){
+			case RNG_XOSHIRO256:
+				walkers[t].xoshiro.seed(seed, t);
+				place_walker(walkers[t], walkers[t].xoshiro);
+				break;
+			case RNG_PCG32:
+				walkers[t].pcg.seed(seed, t);
+				place_walker(walkers[t], walkers[t].pcg);
+				break;
+			case RNG_SPLITMIX:
+				walkers[t].splitmix.seed(seed, t);
+				place_walker(walkers[t], walkers[t].splitmix);
+				break;
+		}
+		walkers[t].num_points = 0;
+		walkers[t].iterations = 0;
+		walkers[t].index = t;
+		walkers[t].stream_buffer.assign(3 * sizeof(uint32_t), 0);
+		walkers[t].stream_records = 0;
+		walkers[t].stream_x = 0;
+		walkers[t].stream_y = 0;
+		walkers[t].published_iterations = 0;
+		walkers[t].published_points = 0;
+		walkers[t].vertex = t % num_vertices;
+		walkers[t].fixed_x = to_q32(walkers[t].x);
+		walkers[t].fixed_y = to_q32(walkers[t].y);
+		if (recording == RECORD_POINTS){
+			ArenaVector<Point>(ArenaAllocator<Point>(&arena)).swap(walkers[t].new_points);
+			ArenaVector<Point>(ArenaAllocator<Point>(&arena)).swap(walkers[t].pending);
+			walkers[t].new_points.reserve(stepping + 1);
+			walkers[t].pending.reserve(pending_points());
+		}
+		if (burn_in == 0 && plot_point(walkers[t], uint32_t (walkers[t].x), uint32_t (walkers[t].y))){
+			record_point(walkers[t], walkers[t].x, walkers[t].y, recording);
+		}
+	}
+	if (burn_in > 0){
+		std::vector<std::thread> warmers;
+		for (size_t t = 1; t < walkers.size(); t++){
+			warmers.push_back(std::thread(&Game::warm_up_walker, this, std::ref(walkers[t])));
+		}
+		warm_up_walker(walkers[0]);
+		for (size_t t = 0; t < warmers.size(); t++){
+			warmers[t].join();
+		}
+	}
+}
+
+/**
+* Runs a walker for a number of iterations with the generator Rng, or until the game stops.
+* The loop is specialized at compile time, so that the common cases carry no code they do not need:
+* Streaming for the point stream, Vertices for a number of vertices known in advance, 0 for any,
+* which turns the die roll into a multiply by a constant, and Half for a fraction of 0.5, where the point
+* moves in fixed point with an add and a shift.
+* @param walker: The walker to advance
+* @param iterations: Number of points to generate
+* @param recording: How newly discovered points are recorded
+* @return The number of iterations that were run.
+*/
+template <class Rng, bool Streaming, int Vertices, bool Half>
+uint64_t Game::run_walker_loop(Walker &walker, uint64_t iterations, Recording recording){
+	// Work on local copies of the state, so walkers on other threads never share its cache lines
+	Rng rng = walker_rng<Rng>(walker);
+	float x = walker.x;
+	float y = walker.y;
+	uint64_t fixed_x = uint64_t (x * (1 << FIXED_SHIFT) + 0.5f);
+	uint64_t fixed_y = uint64_t (y * (1 << FIXED_SHIFT) + 0.5f);
+	const uint32_t range = Vertices > 0 ? Vertices : num_vertices;
+	const uint32_t threshold = Vertices > 0 ? (0u - Vertices) % Vertices : die_threshold;
+	const float *vx = vertex_x.data(), *vy = vertex_y.data();
+	const uint64_t *fixed_vx = vertex_fixed_x.data(), *fixed_vy = vertex_fixed_y.data();
+	const float keep = 1.0f - factor, move = factor;
+	const bool stream_all = flag_stream_all;
+	uint64_t i = 0;
+	while (i < iterations && playing()){
+		uint64_t batch_end = std::min(iterations, i + WALKER_BATCH);
+		for (; i < batch_end; i++){
+			uint32_t vertex = uniform_below(rng, range, threshold);
+			uint32_t cell_x, cell_y;
+			if (Half){
+				next_point_half(fixed_x, fixed_y, fixed_vx[vertex], fixed_vy[vertex]);
+				cell_x = fixed_x >> FIXED_SHIFT;
+				cell_y = fixed_y >> FIXED_SHIFT;
+			}
+			else{
+				next_point(x, y, vx[vertex], vy[vertex], keep, move);
+				cell_x = x;
+				cell_y = y;
+			}
+			bool discovered = plot_point(walker, cell_x, cell_y);
+			if (discovered){
+				record_point(walker, cell_x, cell_y, recording);
+			}
+			if (Streaming && (discovered || stream_all)){
+				stream_point(walker, cell_x, cell_y, vertex);
+			}
+		}
+	}
+	walker_rng<Rng>(walker) = rng;
+	if (Half){
+		x = float (fixed_x) / (1 << FIXED_SHIFT);
+		y = float (fixed_y) / (1 << FIXED_SHIFT);
+	}
+	walker.x = x;
+	walker.y = y;
+	return i;
+}
+
+/**
+* Runs a walker by the IFS rules for a number of iterations with the generator Rng, or until the game
+* stops. Choosing a vertex and applying its map are branch free; points that a map sends off the
+* grid are not plotted.
+* @param walker: The walker to advance
+* @param iterations: Number of points to generate
+* @param recording: How newly discovered points are recorded
+* @return The number of iterations that were run.
+*/
+template <class Rng, bool Streaming>
+uint64_t Game::run_ifs_loop(Walker &walker, uint64_t iterations, Recording recording){
+	Rng rng = walker_rng<Rng>(walker);
+	float x = walker.x;
+	float y = walker.y;
+	uint32_t vertex = walker.vertex;
+	const uint32_t n = num_vertices;
+	const uint32_t *threshold = alias_threshold.data(), *other = alias_other.data();
+	const AffineMap *maps = ifs_maps.data();
+	const float width = render_width, height = render_height;
+	const bool stream_all = flag_stream_all;
+	uint64_t i = 0;
+	while (i < iterations && playing()){
+		uint64_t batch_end = std::min(iterations, i + WALKER_BATCH);
+		for (; i < batch_end; i++){
+			vertex = choose_vertex(rng.next_u32(), n, vertex, threshold, other);
+			apply_map(maps[vertex], x, y);
+			bool inside = (x >= 0.0f) & (x < width) & (y >= 0.0f) & (y < height);
+			if (__builtin_expect(!inside, 0)){
+				continue;
+			}
+			uint32_t cell_x = x, cell_y = y;
+			bool discovered = plot_point(walker, cell_x, cell_y);
+			if (discovered){
+				record_point(walker, cell_x, cell_y, recording);
+			}
+			if (Streaming && (discovered || stream_all)){
+				stream_point(walker, cell_x, cell_y, vertex);
+			}
+		}
+	}
+	walker_rng<Rng>(walker) = rng;
+	walker.x = x;
+	walker.y = y;
+	walker.vertex = vertex;
+	return i;
+}
+
+/**
+* Runs a walker with the fixed kernel for a number of iterations with the generator Rng, or until the game
+* stops. The point moves in Q32.32 with integer multiplies, adds and shifts only, with no float
+* and no rounding mode involved, so a seed plots the same points wherever it runs.
+* @param walker: The walker to advance
+* @param iterations: Number of points to generate
+* @param recording: How newly discovered points are recorded
+* @return The number of iterations that were run.
+*/
+template <class Rng, bool Streaming>
+uint64_t Game::run_fixed_loop(Walker &walker, uint64_t iterations, Recording recording){
+	Rng rng = walker_rng<Rng>(walker);
+	uint64_t x = walker.fixed_x;
+	uint64_t y = walker.fixed_y;
+	const uint32_t range = num_vertices, threshold = die_threshold;
+	const uint64_t *vx = vertex_q32_x.data(), *vy = vertex_q32_y.data();
+	const uint64_t move = factor_q32;
+	const bool stream_all = flag_stream_all;
+	uint64_t i = 0;
+	while (i < iterations && playing()){
+		uint64_t batch_end = std::min(iterations, i + WALKER_BATCH);
+		for (; i < batch_end; i++){
+			uint32_t vertex = uniform_below(rng, range, threshold);
+			next_point_q32(x, y, vx[vertex], vy[vertex], move);
+			uint32_t cell_x = x >> Q32_SHIFT, cell_y = y >> Q32_SHIFT;
+			bool discovered = plot_point(walker, cell_x, cell_y);
+			if (discovered){
+				record_point(walker, cell_x, cell_y, recording);
+			}
+			if (Streaming && (discovered || stream_all)){
+				stream_point(walker, cell_x, cell_y, vertex);
+			}
+		}
+	}
+	walker_rng<Rng>(walker) = rng;
+	walker.fixed_x = x;
+	walker.fixed_y = y;
+	walker.x = from_q32(x);
+	walker.y = from_q32(y);
+	return i;
+}
+
+/**
+* Looks up the loop specialized for the number of vertices in a table of loops, for 0 (any) and 3 to 8.
+*/
+template <class Rng, bool Streaming, bool Half>
+Game::WalkerLoop Game::find_walker_loop(){
+	static const WalkerLoop loops[] = {
+		&Game::run_walker_loop<Rng, Streaming, 0, Half>, nullptr, nullptr,
+		&Game::run_walker_loop<Rng, Streaming, 3, Half>, &Game::run_walker_loop<Rng, Streaming, 4, Half>,
+		&Game::run_walker_loop<Rng, Streaming, 5, Half>, &Game::run_walker_loop<Rng, Streaming, 6, Half>,
+		&Game::run_walker_loop<Rng, Streaming, 7, Half>, &Game::run_walker_loop<Rng, Streaming, 8, Half>
+	};
+	return num_vertices >= 3 && num_vertices <= 8 ? loops[num_vertices] : loops[0];
+}
+
+/**
+* Selects the scalar loop for the current parameters. The generic loop handles other vertex counts and fractions,
+* and IFS mode and the fixed kernel have loops of their own.
+*/
+template <class Rng>
+Game::WalkerLoop Game::find_walker_loop(){
+	if (flag_ifs){
+		return flag_stream ? &Game::run_ifs_loop<Rng, true> : &Game::run_ifs_loop<Rng, false>;
+	}
+	if (kernel_kind == KERNEL_FIXED){
+		return flag_stream ? &Game::run_fixed_loop<Rng, true> : &Game::run_fixed_loop<Rng, false>;
+	}
+	bool half = factor == 0.5f;
+	if (flag_stream){
+		return half ? find_walker_loop<Rng, true, true>() : find_walker_loop<Rng, true, false>();
+	}
+	return half ? find_walker_loop<Rng, false, true>() : find_walker_loop<Rng, false, false>();
+}
+
+/**
+* Selects the scalar loop for the current parameters and rng_kind.
+*/
+Game::WalkerLoop Game::find_walker_loop(){
+	switch (rng_kind){
+		case RNG_PCG32:
+			return find_walker_loop<Pcg32>();
+		case RNG_SPLITMIX:
+			return find_walker_loop<SplitMix64>();
+		default:
+			return find_walker_loop<Xoshiro256>();
+	}
+}
+
+/**
+* Runs a walker's SIMD lanes with simd_kernel for a number of iterations, or until the game
+* stops. The kernel writes points in chunks, which are then plotted. When the number of iterations
+* is not a multiple of SIMD_LANES, the last step only plots the points of its first lanes, and drops the others.
+* @return The number of iterations that were run.
+*/
+uint64_t Game::run_walker_simd(Walker &walker, uint64_t iterations, Recording recording){
+	SimdParams params = {vertex_x.data(), vertex_y.data(), num_vertices, factor, die_threshold};
+	uint32_t xs[SIMD_CHUNK * SIMD_LANES], ys[SIMD_CHUNK * SIMD_LANES], vs[SIMD_CHUNK * SIMD_LANES];
+	const bool streaming = flag_stream, stream_all = flag_stream_all;
+	uint64_t steps = (iterations + SIMD_LANES - 1) / SIMD_LANES;
+	uint64_t step = 0, done = 0;
+	while (step < steps && playing()){
+		size_t chunk = std::min(uint64_t (SIMD_CHUNK), steps - step);
+		simd_kernel(walker.lanes, params, xs, ys, streaming ? vs : nullptr, chunk);
+		size_t points = std::min(uint64_t (chunk * SIMD_LANES), iterations - done);
+		for (size_t i = 0; i < points; i++){
+			bool discovered = plot_point(walker, xs[i], ys[i]);
+			if (discovered){
+				record_point(walker, xs[i], ys[i], recording);
+			}
+			if (streaming && (discovered || stream_all)){
+				stream_point(walker, xs[i], ys[i], vs[i]);
+			}
+		}
+		step += chunk;
+		done += points;
+	}
+	return done;
+}
+
+/**
+* Runs a walker in the zoomed view for a number of iterations with the generator Rng, or until the game
+* stops. The walker moves as it does in the whole grid, by the polygon or the IFS rules, but only the
+* points inside the view are plotted, into view_occupancy, and new ones handed over in view pixels.
+* They are neither counted in num_points nor streamed.
+* @param walker: The walker to advance
+* @param iterations: Number of points to generate
+* @param recording: How newly discovered points are recorded
+* @return The number of iterations that were run.
+*/
+template <class Rng>
+uint64_t Game::run_view_loop(Walker &walker, uint64_t iterations, Recording recording){
+	Rng rng = walker_rng<Rng>(walker);
+	float x = walker.x;
+	float y = walker.y;
+	uint32_t vertex = walker.vertex;
+	const bool ifs = flag_ifs;
+	const uint32_t n = num_vertices;
+	const uint32_t *threshold = alias_threshold.data(), *other = alias_other.data();
+	const AffineMap *maps = ifs_maps.data();
+	const float *vx = vertex_x.data(), *vy = vertex_y.data();
+	const float keep = 1.0f - factor, move = factor;
+	const float x0 = view_x0, y0 = view_y0, scale = view_scale;
+	const float width = view_width, height = view_height;
+	uint64_t i = 0;
+	while (i < iterations && playing()){
+		uint64_t batch_end = std::min(iterations, i + WALKER_BATCH);
+		for (; i < batch_end; i++){
+			if (ifs){
+				vertex = choose_vertex(rng.next_u32(), n, vertex, threshold, other);
+				apply_map(maps[vertex], x, y);
+			}
+			else{
+				vertex = uniform_below(rng, n, die_threshold);
+				next_point(x, y, vx[vertex], vy[vertex], keep, move);
+			}
+			float pixel_x = (x - x0) * scale, pixel_y = (y - y0) * scale;
+			bool inside = (pixel_x >= 0.0f) & (pixel_x < width) & (pixel_y >= 0.0f) & (pixel_y < height);
+			if (!inside){
+				continue;
+			}
+			uint32_t cell_x = pixel_x, cell_y = pixel_y;
+			if (mark_view_point(cell_x, cell_y) && recording == RECORD_POINTS){
+				walker.new_points.push_back(Point {cell_x, cell_y});
+			}
+		}
+	}
+	walker_rng<Rng>(walker) = rng;
+	walker.x = x;
+	walker.y = y;
+	walker.vertex = vertex;
+	walker.fixed_x = to_q32(x);
+	walker.fixed_y = to_q32(y);
+	return i;
+}
+
+/**
+* Runs a walker in the zoomed view with the generator selected by rng_kind.
+*/
+uint64_t Game::run_view(Walker &walker, uint64_t iterations, Recording recording){
+	switch (rng_kind){
+		case RNG_PCG32:
+			return run_view_loop<Pcg32>(walker, iterations, recording);
+		case RNG_SPLITMIX:
+			return run_view_loop<SplitMix64>(walker, iterations, recording);
+		default:
+			return run_view_loop<Xoshiro256>(walker, iterations, recording);
+	}
+}
+
+/**
+* Runs a walker for a number of iterations with the kernel selected by kernel_kind,
+* and the generator selected by rng_kind, or in the zoomed view with run_view. In tiled mode the walker's
+* bin is flushed afterwards, and in stream mode its buffered records.
+*/
+uint64_t Game::run_walker(Walker &walker, uint64_t iterations, Recording recording){
+	uint64_t done;
+	if (__builtin_expect(flag_zoomed, 0)){
+		return run_view(walker, iterations, recording);
+	}
+	if (simd_kernel != nullptr){
+		done = run_walker_simd(walker, iterations, recording);
+	}
+	else{
+		done = (this->*walker_loop)(walker, iterations, recording);
+	}
+	if (flag_tiled){
+		flush_bin(walker);
+	}
+	if (flag_stream){
+		flush_stream(walker);
+	}
+	return done;
+}
+
+/**
+* Splits a number of iterations between the walkers and runs each walker on its own thread.
+* The calling thread runs the first walker.
+* @param iterations: Total number of points to generate across all walkers
+* @param recording: How newly discovered points are recorded
+* @return The number of iterations that were run.
+*/
+uint64_t Game::run_walkers(uint64_t iterations, Recording recording){
+	std::vector<uint64_t> done(walkers.size(), 0);
+	std::vector<std::thread> runners;
+	for (size_t t = 1; t < walkers.size(); t++){
+		runners.push_back(std::thread([&, t](){
+			done[t] = run_walker(walkers[t], iterations / walkers.size(), recording);
+		}));
+	}
+	done[0] = run_walker(walkers[0], iterations / walkers.size() + iterations % walkers.size(), recording);
+	uint64_t total = done[0];
+	for (size_t t = 1; t < walkers.size(); t++){
+		runners[t - 1].join();
+		total += done[t];
+	}
+	return total;
+}
+
+/**
+* Hands the points a walker discovered since its last call over to the caller.
+* @return false if pending has no room for them, in which case they stay in new_points.
+*/
+bool publish_points(Walker &walker){
+	std::lock_guard<std::mutex> lock(walker.mutex);
+	walker.published_iterations = walker.iterations;
+	walker.published_points = walker.num_points;
+	if (walker.new_points.size() > walker.pending.capacity() - walker.pending.size()){
+		return false;
+	}
+	walker.pending.insert(walker.pending.end(), walker.new_points.begin(), walker.new_points.end());
+	walker.new_points.clear();
+	return true;
+}
+
+/**
+* Takes the points a walker has published, appending them to points.
+*/
+void take_points(Walker &walker, std::vector<Point> &points){
+	std::lock_guard<std::mutex> lock(walker.mutex);
+	points.insert(points.end(), walker.pending.begin(), walker.pending.end());
+	walker.pending.clear();
+}
+
+/**
+* Returns the iterations run and the unique points found by the walkers, as last published, summed.
+*/
+void published_progress(std::vector<Walker> &walkers, uint64_t &iterations, uint64_t &points){
+	iterations = 0;
+	points = 0;
+	for (size_t t = 0; t < walkers.size(); t++){
+		std::lock_guard<std::mutex> lock(walkers[t].mutex);
+		iterations += walkers[t].published_iterations;
+		points += walkers[t].published_points;
+	}
+}
+
+/**
+* Runs a walker continuously on its own thread, publishing its new points every stepping iterations,
+* until the game stops. A walker whose last points the caller has no room for yet waits for it to take
+* its pending points, instead of growing its buffers.
+*/
+void Game::simulate(Walker &walker){
+	while (playing()){
+		if (flag_pause){
+			std::unique_lock<std::mutex> lock(pause_mutex);
+			walkers_paused++;
+			pause_cv.notify_all();
+			while (flag_pause && playing()){
+				pause_cv.wait_for(lock, std::chrono::milliseconds(10));
+			}
+			walkers_paused--;
+		}
+		if (!publish_points(walker)){
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+		walker.iterations += run_walker(walker, stepping, recording);
+	}
+}
+
+/**
+* Returns the number of iterations the walkers have run in simulate.
+*/
+uint64_t walker_iterations(const std::vector<Walker> &walkers){
+	uint64_t total = 0;
+	for (size_t t = 0; t < walkers.size(); t++){
+		total += walkers[t].iterations;
+	}
+	return total;
+}
+
+/**
+* Parks every walker running in simulate, returning once they are all parked or the game ends.
+* @return true if every walker is parked.
+*/
+bool Game::pause_walkers(){
+	std::unique_lock<std::mutex> lock(pause_mutex);
+	flag_pause = true;
+	while (walkers_paused < threads.size() && playing()){
+		pause_cv.wait_for(lock, std::chrono::milliseconds(10));
+	}
+	return walkers_paused == threads.size();
+}
+
+/**
+* Lets the walkers parked by pause_walkers continue.
+*/
+void Game::resume_walkers(){
+	std::lock_guard<std::mutex> lock(pause_mutex);
+	flag_pause = false;
+	pause_cv.notify_all();
+}
+
+/**
+* Places the view at a zoom around a centre in render cells, the whole grid for a zoom of 1, without touching
+* its pixels. The centre is kept on the grid.
+*/
+void Game::place_view(double center_x, double center_y, double zoom){
+	view_zoom = std::min(std::max(zoom, 1.0), ChaosEngine::MAX_ZOOM);
+	flag_zoomed = view_zoom > 1.0;
+	view_center_x = flag_zoomed ? std::min(std::max(center_x, 0.0), double (render_width)) : render_width / 2.0;
+	view_center_y = flag_zoomed ? std::min(std::max(center_y, 0.0), double (render_height)) : render_height / 2.0;
+	double scale = std::min(double (view_width) / render_width, double (view_height) / render_height) * view_zoom;
+	view_scale = scale;
+	view_x0 = view_center_x - view_width / 2.0 / scale;
+	view_y0 = view_center_y - view_height / 2.0 / scale;
+}
+
+/**
+* Returns the row scratch of the calling thread.
+*/
+RowScratch &thread_row_scratch(){
+	static thread_local RowScratch scratch;
+	return scratch;
+}
+
+/**
+* Sums the grid over the cells of every pixel in one row of an out_width x out_height downsampled image.
+* @param scratch: Its sums receive out_width sums, of hit counts in density mode or of marked cells otherwise,
+* and its cells the number of cells in each pixel of the row
+*/
+void Game::sum_row(RowScratch &scratch, uint32_t out_width, uint32_t out_height, uint32_t row){
+	std::vector<uint64_t> &sums = scratch.sums;
+	std::vector<uint32_t> &cells = scratch.cells;
+	sums.assign(out_width, 0);
+	cells.resize(out_width);
+
+	// At one cell per pixel, as in exported images without supersampling, the row is read straight from the grid
+	if (out_width == render_width && out_height == render_height && !flag_tiled){
+		std::fill(cells.begin(), cells.end(), 1);
+		uint64_t start = uint64_t (row) * render_width;
+		if (flag_density){
+			for (uint32_t x = 0; x < out_width; x++){
+				sums[x] = density[density_index(x, row)].load(std::memory_order_relaxed);
+			}
+			return;
+		}
+		for (uint32_t x = 0; x < out_width; x++){
+			uint64_t index = start + x;
+			sums[x] = (occupancy[index >> 6].load(std::memory_order_relaxed) >> (index & 63)) & 1;
+		}
+		return;
+	}
+	// Rows of the tile file are read under tile_mutex, so that the bands rendered on other threads
+	// cannot unmap the tiles of this one while it reads them
+	std::unique_lock<std::mutex> tile_lock(tile_mutex, std::defer_lock);
+	TileCursor cursor = {0, 0, nullptr};
+	if (flag_tiled){
+		tile_lock.lock();
+	}
+	uint32_t y0 = first_cell(row, out_height, render_height), y1 = first_cell(row + 1, out_height, render_height);
+	for (uint32_t x = 0; x < out_width; x++){
+		uint32_t x0 = first_cell(x, out_width, render_width), x1 = first_cell(x + 1, out_width, render_width);
+		cells[x] = (x1 - x0) * (y1 - y0);
+		uint64_t sum = 0;
+		for (uint32_t cy = y0; cy < y1; cy++){
+			for (uint32_t cx = x0; cx < x1; cx++){
+				if (flag_tiled){
+					sum += tiled_cell(cursor, cx, cy);
+				}
+				else if (flag_density){
+					sum += density[density_index(cx, cy)].load(std::memory_order_relaxed);
+				}
+				else{
+					uint64_t index = uint64_t (cy) * render_width + cx;
+					sum += (occupancy[index >> 6].load(std::memory_order_relaxed) >> (index & 63)) & 1;
+				}
+			}
+		}
+		sums[x] = sum;
+	}
+}
+
+/**
+* Returns the highest mean hit count of the pixels in an out_width x out_height downsampled image,
+* which tone mapping scales to the points colour.
+*/
+float Game::density_peak(RowScratch &scratch, uint32_t out_width, uint32_t out_height){
+	const std::vector<uint64_t> &sums = scratch.sums;
+	const std::vector<uint32_t> &cells = scratch.cells;
+	float peak = 0;
+	for (uint32_t y = 0; y < out_height; y++){
+		sum_row(scratch, out_width, out_height, y);
+		for (uint32_t x = 0; x < out_width; x++){
+			if (cells[x] > 0){
+				peak = std::max(peak, float (sums[x]) / cells[x]);
+			}
+		}
+	}
+	return peak;
+}
+
+/**
+* Renders one row of an out_width x out_height downsampled image into ARGB8888 pixels.
+* Marked cells blend each pixel by their coverage. Density counts are averaged over the pixel and
+* tone mapped: log mapping uses log(1 + mean) / log(1 + peak), gamma mapping uses (mean / peak)^(1 / gamma).
+* @param out: Receives out_width pixels
+* @param hits: Receives the out_width sums of the pixels, clamped to 32 bits, unless nullptr
+* @param peak: The highest mean hit count, from density_peak
+*/
+void Game::render_row(RowScratch &scratch, uint32_t *out, uint32_t *hits, uint32_t out_width, uint32_t out_height, uint32_t row, float peak){
+	const std::vector<uint64_t> &sums = scratch.sums;
+	const std::vector<uint32_t> &cells = scratch.cells;
+	sum_row(scratch, out_width, out_height, row);
+	uint32_t background = argb(CHAOS_BACKGROUND);
+	for (uint32_t x = 0; x < out_width; x++){
+		if (hits != nullptr){
+			hits[x] = uint32_t (std::min(sums[x], uint64_t (UINT32_MAX)));
+		}
+		if (sums[x] == 0){
+			out[x] = background;
+		}
+		else if (!flag_density){
+			out[x] = blend_argb(float (sums[x]) / cells[x]);
+		}
+		else if (tone_kind == TONE_LOG){
+			out[x] = blend_argb(std::log1p(float (sums[x]) / cells[x]) / std::log1p(peak));
+		}
+		else{
+			out[x] = blend_argb(std::pow(float (sums[x]) / cells[x] / peak, 1.0f / gamma_value));
+		}
+	}
+}
+
+/**
+* Renders the grid, downsampled to out_width x out_height, into ARGB8888 pixels, with the row scratch of the
+* calling thread, so that a thread rendering frames of the same size allocates nothing after the first.
+* @param hits: Resized to the pixels and receives their sums, unless nullptr
+*/
+void Game::render_pixels(std::vector<uint32_t> &out, uint32_t out_width, uint32_t out_height, std::vector<uint32_t> *hits){
+	RowScratch &scratch = thread_row_scratch();
+	out.resize(size_t (out_width) * out_height);
+	if (hits != nullptr){
+		hits->resize(out.size());
+	}
+	float peak = flag_density ? density_peak(scratch, out_width, out_height) : 0;
+	for (uint32_t y = 0; y < out_height; y++){
+		size_t start = size_t (y) * out_width;
+		render_row(scratch, &out[start], hits != nullptr ? &(*hits)[start] : nullptr, out_width, out_height, y, peak);
+	}
+}
+
+/**
+* Geometry of an exported image: the grid downsampled by supersample, with the density peak of the image,
+* and the format it is encoded in.
+*/
+struct ImageExport {
+	uint32_t width, height;
+	float peak;
+	ImageFormat format;
+};
+
+/**
+* Renders row y of an exported image, with the vertices drawn on it, as RGB bytes.
+* @param scratch: The row scratch of the calling thread
+* @param image: The image being exported
+* @param y: The row to render
+* @param frame: Holds width ARGB pixels, the row before conversion
+* @param rgb: Receives width * 3 bytes
+*/
+void Game::image_row(RowScratch &scratch, const ImageExport &image, uint32_t y, uint32_t *frame, uint8_t *rgb){
+	render_row(scratch, frame, nullptr, image.width, image.height, y, image.peak);
+	for (uint32_t x = 0; x < image.width; x++){
+		rgb[x * 3 + 0] = frame[x] >> 16;
+		rgb[x * 3 + 1] = frame[x] >> 8;
+		rgb[x * 3 + 2] = frame[x];
+	}
+	for (int i = 0; i < num_vertices; i++){
+		if (uint64_t (vertices[i].y) * image.height / render_height == y){
+			uint32_t x = uint64_t (vertices[i].x) * image.width / render_width;
+			rgb[x * 3 + 0] = CHAOS_VERTICES[0];
+			rgb[x * 3 + 1] = CHAOS_VERTICES[1];
+			rgb[x * 3 + 2] = CHAOS_VERTICES[2];
+		}
+	}
+}
+
+/**
+* Encodes a band of EXPORT_BAND_ROWS rows of an exported image: as raw RGB for PPM, or for PNG as filtered rows
+* deflated on their own, ending on a byte boundary unless the band is the last, so that the bands of all threads
+* concatenate into one deflate stream, as in parallel gzip. The first band starts with the zlib header.
+* @param image: The image being exported
+* @param band: The band to encode
+* @param out: Receives the encoded band
+* @param adler: Receives the Adler-32 checksum of the band's filtered rows, for PNG
+* @return false if deflate failed.
+*/
+bool Game::encode_band(const ImageExport &image, uint32_t band, std::vector<uint8_t> &out, unsigned long &adler){
+	uint32_t y0 = band * EXPORT_BAND_ROWS;
+	uint32_t y1 = std::min(image.height, y0 + EXPORT_BAND_ROWS);
+	size_t row_size = size_t (image.width) * 3;
+	std::vector<uint32_t> frame(image.width);
+	RowScratch &scratch = thread_row_scratch();
+	if (image.format == IMAGE_PPM){
+		out.resize((y1 - y0) * row_size);
+		for (uint32_t y = y0; y < y1; y++){
+			image_row(scratch, image, y, frame.data(), &out[(y - y0) * row_size]);
+		}
+		return true;
+	}
+
+	// Rows are filtered with Sub, which turns the runs of a colour into runs of zeros
+	std::vector<uint8_t> row(row_size + 1), filtered(row_size + 1);
+	z_stream stream;
+	std::memset(&stream, 0, sizeof(stream));
+	if (deflateInit2(&stream, PNG_LEVEL, Z_DEFLATED, -15, 8, Z_RLE) != Z_OK){
+		return false;
+	}
+	size_t header = band == 0 ? 2 : 0;
+	out.resize(header + deflateBound(&stream, (y1 - y0) * (row_size + 1)) + 16);
+	if (band == 0){
+		out[0] = 0x78;
+		out[1] = 0x01;
+	}
+	stream.next_out = &out[header];
+	stream.avail_out = out.size() - header;
+	adler = adler32(0, nullptr, 0);
+	bool last = y1 == image.height;
+	bool ok = true;
+	for (uint32_t y = y0; y < y1 && ok; y++){
+		image_row(scratch, image, y, frame.data(), &row[1]);
+		filtered[0] = 1;
+		for (size_t i = 1; i <= row_size; i++){
+			filtered[i] = i > 3 ? row[i] - row[i - 3] : row[i];
+		}
+		adler = adler32(adler, filtered.data(), filtered.size());
+		stream.next_in = filtered.data();
+		stream.avail_in = filtered.size();
+		int flush = y + 1 < y1 ? Z_NO_FLUSH : last ? Z_FINISH : Z_SYNC_FLUSH;
+		int status = deflate(&stream, flush);
+		ok = stream.avail_in == 0 && status != Z_STREAM_ERROR && (flush != Z_FINISH || status == Z_STREAM_END);
+	}
+	out.resize(out.size() - stream.avail_out);
+	deflateEnd(&stream);
+	return ok;
+}
+
+/**
+* Writes a PNG chunk of the given type.
+*/
+void write_png_chunk(std::ostream &file, const char *type, const uint8_t *data, size_t size){
+	uint8_t length[4] = {uint8_t (size >> 24), uint8_t (size >> 16), uint8_t (size >> 8), uint8_t (size)};
+	uLong crc = crc32(0, reinterpret_cast<const Bytef *>(type), 4);
+	if (size > 0){
+		crc = crc32(crc, data, size);
+	}
+	uint8_t check[4] = {uint8_t (crc >> 24), uint8_t (crc >> 16), uint8_t (crc >> 8), uint8_t (crc)};
+	file.write(reinterpret_cast<const char *>(length), 4);
+	file.write(type, 4);
+	file.write(reinterpret_cast<const char *>(data), size);
+	file.write(reinterpret_cast<const char *>(check), 4);
+}
+
+/**
+* Writes the grid, downsampled by supersample, and the vertices to an image, PPM or PNG.
+* Bands of rows are rendered and encoded on all cores, and written in order as they complete, each as its own
+* IDAT chunk in PNG. At most two bands per thread are held at a time, so the image is never held in memory.
+* @param file: The stream to write to, which is flushed at the end
+* @param format: The format of the image
+* @return true if the image was written successfully.
+*/
+bool Game::write_image(std::ostream &file, ImageFormat format){
+	ImageExport image;
+	image.width = std::max(render_width / supersample, 1u);
+	image.height = std::max(render_height / supersample, 1u);
+	image.peak = flag_density ? density_peak(thread_row_scratch(), image.width, image.height) : 0;
+	image.format = format;
+	if (image.format == IMAGE_PPM){
+		file << "P6\n" << image.width << " " << image.height << "\n255\n";
+	}
+	else{
+		const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+		const uint8_t header[13] = {
+			uint8_t (image.width >> 24), uint8_t (image.width >> 16), uint8_t (image.width >> 8), uint8_t (image.width),
+			uint8_t (image.height >> 24), uint8_t (image.height >> 16), uint8_t (image.height >> 8), uint8_t (image.height),
+			8, 2, 0, 0, 0
+		};
+		file.write(reinterpret_cast<const char *>(signature), sizeof(signature));
+		write_png_chunk(file, "IHDR", header, sizeof(header));
+	}
+
+	// Threads take the next band unless it is more than window bands ahead of the writer
+	uint32_t bands = (image.height + EXPORT_BAND_ROWS - 1) / EXPORT_BAND_ROWS;
+	uint32_t num_encoders = std::max(1u, std::min(std::thread::hardware_concurrency(), bands));
+	uint32_t window = 2 * num_encoders;
+	std::vector<std::vector<uint8_t> > outputs(bands);
+	std::vector<uLong> adlers(bands);
+	std::vector<uint8_t> done(bands, 0);
+	uint32_t next_band = 0, written = 0;
+	bool failed = false;
+	std::mutex mutex;
+	std::condition_variable changed;
+	auto encode = [&](){
+		std::unique_lock<std::mutex> lock(mutex);
+		while (next_band < bands && !failed){
+			if (next_band >= written + window){
+				changed.wait(lock);
+				continue;
+			}
+			uint32_t band = next_band++;
+			lock.unlock();
+			std::vector<uint8_t> out;
+			uLong adler = 0;
+			bool ok = encode_band(image, band, out, adler);
+			lock.lock();
+			outputs[band].swap(out);
+			adlers[band] = adler;
+			done[band] = ok ? 1 : 2;
+			changed.notify_all();
+		}
+	};
+	std::vector<std::thread> encoders;
+	for (uint32_t t = 0; t < num_encoders; t++){
+		encoders.push_back(std::thread(encode));
+	}
+
+	uLong adler = adler32(0, nullptr, 0);
+	uint64_t filtered_row = uint64_t (image.width) * 3 + 1;
+	for (uint32_t band = 0; band < bands && !failed && file; band++){
+		std::vector<uint8_t> out;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while (done[band] == 0){
+				changed.wait(lock);
+			}
+			failed = done[band] == 2;
+			out.swap(outputs[band]);
+		}
+		if (!failed && image.format == IMAGE_PPM){
+			file.write(reinterpret_cast<const char *>(out.data()), out.size());
+		}
+		else if (!failed){
+			uint32_t rows = std::min(image.height - band * EXPORT_BAND_ROWS, EXPORT_BAND_ROWS);
+			adler = band == 0 ? adlers[band] : adler32_combine(adler, adlers[band], filtered_row * rows);
+			if (band + 1 == bands){
+				for (int shift = 24; shift >= 0; shift -= 8){
+					out.push_back(uint8_t (adler >> shift));
+				}
+			}
+			write_png_chunk(file, "IDAT", out.data(), out.size());
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		written++;
+		changed.notify_all();
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		failed = failed || !file;
+		changed.notify_all();
+	}
+	for (size_t t = 0; t < encoders.size(); t++){
+		encoders[t].join();
+	}
+	if (!failed && image.format == IMAGE_PNG){
+		write_png_chunk(file, "IEND", nullptr, 0);
+	}
+	file.flush();
+	return !failed && bool (file);
+}
+
+/**
+* Writes the image to a file.
+* @param path: The file to write
+* @param format: The format of the image
+* @return true if the image was written successfully.
+*/
+bool Game::write_image(const std::string &path, ImageFormat format){
+	std::ofstream file(path.c_str(), std::ios::binary);
+	return file && write_image(file, format);
+}
+
+/**
+* Returns the number of iterations it takes a point anywhere on the render grid to come within half a cell
+* of the attractor. Every iteration shrinks the distance between two orbits by 1 - factor, or in IFS mode
+* by at least the largest stretch of the maps. Maps that do not all contract get IFS_BURN_IN iterations.
+*/
+uint64_t Game::transient_iterations(){
+	double distance = std::hypot(double (render_width), double (render_height));
+	double contraction = 1.0 - factor;
+	if (flag_ifs){
+		// The most a map stretches a distance is the largest singular value of its matrix
+		contraction = 0;
+		for (size_t m = 0; m < ifs_maps.size(); m++){
+			const AffineMap &map = ifs_maps[m];
+			double t = map.a * map.a + map.b * map.b + map.c * map.c + map.d * map.d;
+			double det = map.a * map.d - map.b * map.c;
+			contraction = std::max(contraction, std::sqrt((t + std::sqrt(std::max(t * t - 4 * det * det, 0.0))) / 2));
+		}
+		if (contraction >= 1.0){
+			return IFS_BURN_IN;
+		}
+	}
+	return uint64_t (std::ceil(std::log(0.5 / distance) / std::log(contraction)));
+}
+
+/**
+* Returns the size of the arena a game needs: its grid, its zoomed view if it has one, and when recording points
+* the walkers' point buffers, with room for the alignment of every block.
+*/
+size_t Game::arena_bytes(){
+	uint64_t cells = uint64_t (render_width) * render_height;
+	uint64_t bytes = flag_tiled ? 0 : flag_density ? ((render_width + DENSITY_TILE - 1) / DENSITY_TILE) * DENSITY_TILE
+		* ((render_height + DENSITY_TILE - 1) / DENSITY_TILE) * DENSITY_TILE * sizeof(DensityCount) : (cells + 63) / 64 * sizeof(uint64_t);
+	bytes += (uint64_t (view_width) * view_height + 63) / 64 * sizeof(uint64_t);
+	if (recording == RECORD_POINTS){
+		bytes += num_threads * (stepping + 1 + pending_points()) * sizeof(Point);
+	}
+	return bytes + (3 * num_threads + 8) * ARENA_ALIGN;
+}
+
+/**
+* Creates the vertices, selects the SIMD kernel and the burn-in and allocates the occupancy grid, or the density
+* buffer in density mode, with every cell unmarked, and the zoomed view, for the current parameters.
+* The grid is allocated from the arena, rewound for every game, so games of the same size reuse its memory.
+* Tiled mode allocates neither, the tile file is created by setup.
+*/
+void Game::setup_game(){
+	create_vertices();
+	if (flag_ifs){
+		create_ifs();
+	}
+	simd_kernel = find_simd_kernel(kernel_kind);
+	walker_loop = find_walker_loop();
+	if (!flag_burn_in_set){
+		burn_in = transient_iterations();
+	}
+
+	// The buffers of the last game are released, then the arena is rewound, or grown if it is too small
+	std::vector<Walker>().swap(walkers);
+	ArenaVector<std::atomic<uint64_t>>().swap(occupancy);
+	ArenaVector<std::atomic<DensityCount>>().swap(density);
+	ArenaVector<std::atomic<uint64_t>>().swap(view_occupancy);
+	size_t bytes = arena_bytes();
+	if (bytes > arena.capacity){
+		arena.map(bytes);
+	}
+	arena.used = 0;
+	if (flag_density && !flag_tiled){
+		density_tiles_x = (render_width + DENSITY_TILE - 1) / DENSITY_TILE;
+		uint64_t tile_rows = (render_height + DENSITY_TILE - 1) / DENSITY_TILE;
+		ArenaVector<std::atomic<DensityCount>>(density_tiles_x * tile_rows * DENSITY_TILE * DENSITY_TILE,
+			ArenaAllocator<std::atomic<DensityCount>>(&arena)).swap(density);
+	}
+	else if (!flag_tiled){
+		ArenaVector<std::atomic<uint64_t>>((uint64_t (render_width) * render_height + 63) / 64,
+			ArenaAllocator<std::atomic<uint64_t>>(&arena)).swap(occupancy);
+	}
+	if (view_width > 0){
+		ArenaVector<std::atomic<uint64_t>>((uint64_t (view_width) * view_height + 63) / 64,
+			ArenaAllocator<std::atomic<uint64_t>>(&arena)).swap(view_occupancy);
+	}
+}
+
+/**
+* Returns the index of a name in a table of names, or -1 if it is not there.
+*/
+int find_name(const char *const names[], int count, const std::string &name){
+	for (int i = 0; i < count; i++){
+		if (name == names[i]){
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+* Sets up a game from a configuration, in place of the last one: checks the parameters, creates the vertices and
+* the grid, opens the tile file and the point stream, and places and burns in the walkers.
+* @param error: Receives why the game could not be set up, unless nullptr
+* @return false if the configuration is invalid or a file could not be opened, in which case the game is stopped.
+*/
+bool Game::setup(const ChaosConfig &config, std::string *error){
+	teardown();
+	flag_continue = false;
+	std::string kernel = config.kernel == "simd" ? KERNEL_NAMES[best_simd_kernel()] : config.kernel;
+	int kernel_index = find_name(KERNEL_NAMES, KERNEL_LANES + 1, kernel);
+	int rng_index = find_name(RNG_NAMES, RNG_SPLITMIX + 1, config.rng);
+	int tone_index = find_name(TONE_NAMES, TONE_GAMMA + 1, config.tone);
+	int format_index = find_name(STREAM_FORMAT_NAMES, STREAM_VARINT + 1, config.stream_format);
+	bool ifs = !config.weights.empty() || !config.restricted.empty() || !config.maps.empty();
+	bool weighted = false, weights_valid = true;
+	for (size_t i = 0; i < config.weights.size(); i++){
+		weights_valid = weights_valid && config.weights[i] >= 0 && std::isfinite(config.weights[i]);
+		weighted = weighted || config.weights[i] > 0;
+	}
+	bool tiled = !config.tile_file.empty();
+	std::string invalid;
+	if (config.width == 0 || config.width > MAX_RENDER_SIZE || config.height == 0 || config.height > MAX_RENDER_SIZE){
+		invalid = "Invalid render size.";
+	}
+	else if (config.maps.empty() ? config.vertices < 3 || config.vertices > 255 : config.maps.size() > 255){
+		invalid = "Invalid number of vertices.";
+	}
+	else if (!(config.fraction > 0.0f && config.fraction < 1.0f)){
+		invalid = "Invalid factor value.";
+	}
+	else if (config.threads < 1 || config.threads > 1024){
+		invalid = "Invalid number of threads.";
+	}
+	else if (kernel_index < 0){
+		invalid = "Invalid kernel.";
+	}
+	else if (kernel_index != KERNEL_SCALAR && kernel_index != KERNEL_FIXED && find_simd_kernel(KernelKind (kernel_index)) == nullptr){
+		invalid = "Kernel " + kernel + " is not supported on this CPU.";
+	}
+	else if (rng_index < 0){
+		invalid = "Invalid random number generator.";
+	}
+	else if (tone_index < 0 || !(config.gamma > 0)){
+		invalid = "Invalid tone mapping.";
+	}
+	else if (config.supersample < 1 || config.supersample > config.width || config.supersample > config.height){
+		invalid = "Invalid supersampling factor.";
+	}
+	else if (config.stepping < 1){
+		invalid = "Invalid stepping value.";
+	}
+	else if (config.view_width > MAX_RENDER_SIZE || config.view_height > MAX_RENDER_SIZE
+		|| (config.view_width == 0) != (config.view_height == 0)){
+		invalid = "Invalid view size.";
+	}
+	else if (!config.weights.empty() && (!weights_valid || !weighted)){
+		invalid = "Invalid vertex weights.";
+	}
+	else if (!config.maps.empty() && !(config.frame[2] > config.frame[0] && config.frame[3] > config.frame[1])){
+		invalid = "Invalid IFS frame.";
+	}
+	else if (tiled && (config.tile_memory == 0 || config.record_points || config.view_width > 0)){
+		invalid = "Tiled games need tile memory, and neither record points nor have a view.";
+	}
+	else if (format_index < 0){
+		invalid = "Invalid stream format.";
+	}
+	else if (tiled && !config.stream.empty() && !config.stream_all){
+		invalid = "Tiled games can only stream every iteration.";
+	}
+	if (!invalid.empty()){
+		if (error != nullptr){
+			*error = invalid;
+		}
+		return false;
+	}
+
+	render_width = config.width;
+	render_height = config.height;
+	supersample = config.supersample;
+	ifs_file_maps = config.maps;
+	num_vertices = ifs_file_maps.empty() ? config.vertices : ifs_file_maps.size();
+	factor = config.fraction;
+	flag_ifs = ifs;
+	ifs_weights = config.weights;
+	ifs_restrict = config.restricted;
+	std::copy(config.frame, config.frame + 4, ifs_frame);
+	view_width = config.view_width;
+	view_height = config.view_height;
+	flag_density = config.density;
+	tone_kind = ToneKind (tone_index);
+	gamma_value = config.gamma;
+	flag_tiled = tiled;
+	tile_path = config.tile_file;
+	tile_memory = config.tile_memory;
+	stepping = config.stepping;
+	num_iterations = config.iterations;
+	flag_stream = !config.stream.empty();
+	flag_stream_all = config.stream_all;
+	stream_format = StreamFormat (format_index);
+	stream_path = config.stream;
+	num_threads = config.threads;
+	rng_kind = RngKind (rng_index);
+	seed = config.seed;
+	// IFS rules choose a vertex per step from its table, which only the scalar loop does
+	kernel_kind = flag_ifs ? KERNEL_SCALAR : KernelKind (kernel_index);
+	flag_burn_in_set = config.burn_in >= 0;
+	burn_in = flag_burn_in_set ? config.burn_in : 0;
+	recording = config.record_points ? RECORD_POINTS : RECORD_NONE;
+	iterations = 0;
+	flag_continue = true;
+	flag_pause = false;
+	walkers_paused = 0;
+	setup_game();
+
+	if (flag_tiled && !open_tile_store()){
+		invalid = "Could not create tile file " + tile_path + ".";
+	}
+	else if (flag_stream && !open_stream()){
+		invalid = "Could not open point stream " + stream_path + ".";
+	}
+	if (!invalid.empty()){
+		close_tile_store();
+		close_stream();
+		flag_tiled = false;
+		flag_stream = false;
+		flag_continue = false;
+		if (error != nullptr){
+			*error = invalid;
+		}
+		return false;
+	}
+	if (view_width > 0){
+		place_view(0, 0, 1);
+	}
+	create_walkers();
+	return true;
+}
+
+// Signature and version at the start of every checkpoint file
+const char CHECKPOINT_MAGIC[8] = {'C', 'H', 'A', 'O', 'S', 'C', 'K', 'P'};
+const uint32_t CHECKPOINT_VERSION = 4;
+
+/**
+* Appends an unsigned LEB128 varint.
+*/
+inline void put_varint(std::vector<uint8_t> &out, uint64_t value){
+	while (value >= 0x80){
+		out.push_back(uint8_t (value) | 0x80);
+		value >>= 7;
+	}
+	out.push_back(uint8_t (value));
+}
+
+/**
+* Reads an unsigned LEB128 varint.
+* @return false if the input ends before the varint.
+*/
+inline bool get_varint(const uint8_t *&in, const uint8_t *end, uint64_t &value){
+	value = 0;
+	for (int shift = 0; in < end && shift < 64; shift += 7){
+		uint8_t byte = *in++;
+		value |= uint64_t (byte & 0x7F) << shift;
+		if (!(byte & 0x80)){
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+* Compresses a grid, which is mostly zero away from the attractor, into pairs of varint lengths of
+* a zero run and a literal run, each pair followed by the literal bytes.
+*/
+void compress_grid(const std::vector<uint8_t> &in, std::vector<uint8_t> &out){
+	out.clear();
+	size_t i = 0;
+	while (i < in.size()){
+		size_t zeros = i;
+		while (zeros < in.size() && in[zeros] == 0){
+			zeros++;
+		}
+		// Literal runs end at the next run of at least 8 zeros, shorter runs cost more as pairs
+		size_t literal = zeros;
+		size_t run = 0;
+		while (literal < in.size() && run < 8){
+			run = in[literal] == 0 ? run + 1 : 0;
+			literal++;
+		}
+		if (run == 8){
+			literal -= 8;
+		}
+		put_varint(out, zeros - i);
+		put_varint(out, literal - zeros);
+		out.insert(out.end(), in.begin() + zeros, in.begin() + literal);
+		i = literal;
+	}
+}
+
+/**
+* Expands a grid compressed by compress_grid.
+* @param size: The expected size of the expanded grid
+* @return false if the compressed grid is malformed.
+*/
+bool expand_grid(const uint8_t *in, const uint8_t *end, std::vector<uint8_t> &out, size_t size){
+	out.assign(size, 0);
+	size_t i = 0;
+	while (in < end){
+		uint64_t zeros, literal;
+		if (!get_varint(in, end, zeros) || !get_varint(in, end, literal)
+			|| zeros > size - i || literal > size - i - zeros || literal > uint64_t (end - in)){
+			return false;
+		}
+		i += zeros;
+		std::memcpy(&out[i], in, literal);
+		in += literal;
+		i += literal;
+	}
+	return i == size;
+}
+
+/**
+* Appends the raw bytes of a value.
+*/
+template <class T>
+inline void put_value(std::vector<uint8_t> &out, const T &value){
+	const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+	out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+/**
+* Reads the raw bytes of a value.
+* @return false if the input ends before the value.
+*/
+template <class T>
+inline bool get_value(const uint8_t *&in, const uint8_t *end, T &value){
+	if (uint64_t (end - in) < sizeof(T)){
+		return false;
+	}
+	std::memcpy(&value, in, sizeof(T));
+	in += sizeof(T);
+	return true;
+}
+
+/**
+* Appends a list of values, preceded by its length.
+*/
+template <class T>
+void put_list(std::vector<uint8_t> &out, const std::vector<T> &values){
+	put_value(out, uint32_t (values.size()));
+	for (size_t i = 0; i < values.size(); i++){
+		put_value(out, values[i]);
+	}
+}
+
+/**
+* Reads a list of values written by put_list.
+* @return false if the input ends before the list.
+*/
+template <class T>
+bool get_list(const uint8_t *&in, const uint8_t *end, std::vector<T> &values){
+	uint32_t size;
+	if (!get_value(in, end, size) || size > uint64_t (end - in) / sizeof(T)){
+		return false;
+	}
+	values.resize(size);
+	for (size_t i = 0; i < values.size(); i++){
+		get_value(in, end, values[i]);
+	}
+	return true;
+}
+
+/**
+* Returns the size in bytes of the grid in a checkpoint: of the density buffer or the occupancy grid.
+*/
+size_t Game::grid_bytes(){
+	return flag_density ? density.size() * sizeof(DensityCount) : occupancy.size() * sizeof(uint64_t);
+}
+
+/**
+* Copies the parameters, vertices, walkers and grid into a checkpoint.
+* The walkers must not be running.
+* @param iterations: Number of iterations run so far
+*/
+void Game::take_checkpoint(Checkpoint &checkpoint, uint64_t iterations){
+	checkpoint.render_width = render_width;
+	checkpoint.render_height = render_height;
+	checkpoint.num_vertices = num_vertices;
+	checkpoint.factor = factor;
+	checkpoint.density = flag_density;
+	checkpoint.seed = seed;
+	checkpoint.rng_kind = rng_kind;
+	checkpoint.kernel_kind = logical_kernel(kernel_kind);
+	checkpoint.iterations = iterations;
+	checkpoint.num_iterations = num_iterations;
+	checkpoint.vertices = vertices;
+	checkpoint.ifs = flag_ifs;
+	checkpoint.ifs_weights = ifs_weights;
+	checkpoint.ifs_restrict = ifs_restrict;
+	checkpoint.ifs_file_maps = ifs_file_maps;
+	std::copy(ifs_frame, ifs_frame + 4, checkpoint.ifs_frame);
+	checkpoint.walkers.resize(walkers.size());
+	for (size_t t = 0; t < walkers.size(); t++){
+		WalkerState &state = checkpoint.walkers[t];
+		state.x = walkers[t].x;
+		state.y = walkers[t].y;
+		state.splitmix = walkers[t].splitmix;
+		state.xoshiro = walkers[t].xoshiro;
+		state.pcg = walkers[t].pcg;
+		state.lanes = walkers[t].lanes;
+		state.num_points = walkers[t].num_points;
+		state.vertex = walkers[t].vertex;
+		state.fixed_x = walkers[t].fixed_x;
+		state.fixed_y = walkers[t].fixed_y;
+	}
+	if (flag_density){
+		checkpoint.grid.resize(density.size() * sizeof(DensityCount));
+		for (size_t i = 0; i < density.size(); i++){
+			DensityCount count = density[i].load(std::memory_order_relaxed);
+			std::memcpy(&checkpoint.grid[i * sizeof(DensityCount)], &count, sizeof(DensityCount));
+		}
+	}
+	else{
+		checkpoint.grid.resize(occupancy.size() * sizeof(uint64_t));
+		for (size_t i = 0; i < occupancy.size(); i++){
+			uint64_t word = occupancy[i].load(std::memory_order_relaxed);
+			std::memcpy(&checkpoint.grid[i * sizeof(uint64_t)], &word, sizeof(uint64_t));
+		}
+	}
+}
+
+/**
+* Encodes a checkpoint into the bytes of a checkpoint file, with its grid compressed.
+*/
+void encode_checkpoint(const Checkpoint &checkpoint, std::vector<uint8_t> &data){
+	data.assign(CHECKPOINT_MAGIC, CHECKPOINT_MAGIC + sizeof(CHECKPOINT_MAGIC));
+	put_value(data, CHECKPOINT_VERSION);
+	put_value(data, checkpoint.render_width);
+	put_value(data, checkpoint.render_height);
+	put_value(data, checkpoint.num_vertices);
+	put_value(data, checkpoint.factor);
+	put_value(data, checkpoint.density);
+	put_value(data, checkpoint.seed);
+	put_value(data, checkpoint.rng_kind);
+	put_value(data, checkpoint.kernel_kind);
+	put_value(data, checkpoint.iterations);
+	put_value(data, checkpoint.num_iterations);
+	for (size_t i = 0; i < checkpoint.vertices.size(); i++){
+		put_value(data, checkpoint.vertices[i]);
+	}
+	put_value(data, checkpoint.ifs);
+	put_list(data, checkpoint.ifs_weights);
+	put_list(data, checkpoint.ifs_restrict);
+	put_list(data, checkpoint.ifs_file_maps);
+	put_value(data, checkpoint.ifs_frame);
+	put_value(data, uint32_t (checkpoint.walkers.size()));
+	for (size_t t = 0; t < checkpoint.walkers.size(); t++){
+		put_value(data, checkpoint.walkers[t]);
+	}
+	std::vector<uint8_t> grid;
+	compress_grid(checkpoint.grid, grid);
+	put_value(data, uint64_t (checkpoint.grid.size()));
+	put_value(data, uint64_t (grid.size()));
+	data.insert(data.end(), grid.begin(), grid.end());
+}
+
+/**
+* Writes a checkpoint to path, through a temporary file that replaces it once complete,
+* so that an interrupted write never destroys the previous checkpoint.
+* @return true if the checkpoint was written successfully.
+*/
+bool write_checkpoint(const Checkpoint &checkpoint, const std::string &path){
+	std::vector<uint8_t> data;
+	encode_checkpoint(checkpoint, data);
+	std::string temporary = path + ".tmp";
+	std::ofstream file(temporary.c_str(), std::ios::binary);
+	file.write(reinterpret_cast<const char *>(&data[0]), data.size());
+	file.close();
+	return file && std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+/**
+* Decodes the bytes of a checkpoint file, as encoded by encode_checkpoint.
+* @return true if the checkpoint is valid.
+*/
+bool decode_checkpoint(Checkpoint &checkpoint, const std::vector<uint8_t> &data){
+	const uint8_t *in = data.data(), *end = data.data() + data.size();
+	char magic[sizeof(CHECKPOINT_MAGIC)];
+	uint32_t version, num_walkers;
+	uint64_t grid_size, compressed_size;
+	if (!get_value(in, end, magic) || std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0
+		|| !get_value(in, end, version) || version != CHECKPOINT_VERSION
+		|| !get_value(in, end, checkpoint.render_width) || !get_value(in, end, checkpoint.render_height)
+		|| !get_value(in, end, checkpoint.num_vertices) || !get_value(in, end, checkpoint.factor)
+		|| !get_value(in, end, checkpoint.density) || !get_value(in, end, checkpoint.seed)
+		|| !get_value(in, end, checkpoint.rng_kind) || !get_value(in, end, checkpoint.kernel_kind)
+		|| !get_value(in, end, checkpoint.iterations) || !get_value(in, end, checkpoint.num_iterations)){
+		return false;
+	}
+	checkpoint.vertices.resize(checkpoint.num_vertices);
+	for (size_t i = 0; i < checkpoint.vertices.size(); i++){
+		if (!get_value(in, end, checkpoint.vertices[i])){
+			return false;
+		}
+	}
+	if (!get_value(in, end, checkpoint.ifs) || !get_list(in, end, checkpoint.ifs_weights) || !get_list(in, end, checkpoint.ifs_restrict)
+		|| !get_list(in, end, checkpoint.ifs_file_maps) || !get_value(in, end, checkpoint.ifs_frame)
+		|| (!checkpoint.ifs_file_maps.empty() && checkpoint.ifs_file_maps.size() != checkpoint.num_vertices)){
+		return false;
+	}
+	if (!get_value(in, end, num_walkers) || num_walkers == 0 || num_walkers > UINT16_MAX){
+		return false;
+	}
+	checkpoint.walkers.resize(num_walkers);
+	for (size_t t = 0; t < checkpoint.walkers.size(); t++){
+		if (!get_value(in, end, checkpoint.walkers[t])){
+			return false;
+		}
+	}
+	if (!get_value(in, end, grid_size) || !get_value(in, end, compressed_size) || compressed_size != uint64_t (end - in)){
+		return false;
+	}
+	return checkpoint.rng_kind <= RNG_SPLITMIX && checkpoint.kernel_kind <= KERNEL_LANES
+		&& expand_grid(in, end, checkpoint.grid, grid_size);
+}
+
+/**
+* Restores the vertices, walkers and grid of a checkpoint, once the game is set up and the walkers created.
+* @return false if the grid or the number of walkers does not match the parameters, in which case nothing is restored.
+*/
+bool Game::restore_checkpoint(const Checkpoint &checkpoint){
+	if (checkpoint.grid.size() != grid_bytes() || checkpoint.walkers.size() != walkers.size()){
+		return false;
+	}
+	vertices = checkpoint.vertices;
+	fill_vertex_arrays();
+	for (size_t t = 0; t < walkers.size(); t++){
+		const WalkerState &state = checkpoint.walkers[t];
+		walkers[t].x = state.x;
+		walkers[t].y = state.y;
+		walkers[t].splitmix = state.splitmix;
+		walkers[t].xoshiro = state.xoshiro;
+		walkers[t].pcg = state.pcg;
+		walkers[t].lanes = state.lanes;
+		walkers[t].num_points = state.num_points;
+		walkers[t].vertex = state.vertex % num_vertices;
+		walkers[t].fixed_x = state.fixed_x;
+		walkers[t].fixed_y = state.fixed_y;
+		walkers[t].new_points.clear();
+	}
+	if (flag_density){
+		for (size_t i = 0; i < density.size(); i++){
+			DensityCount count;
+			std::memcpy(&count, &checkpoint.grid[i * sizeof(DensityCount)], sizeof(DensityCount));
+			density[i].store(count, std::memory_order_relaxed);
+		}
+	}
+	else{
+		for (size_t i = 0; i < occupancy.size(); i++){
+			uint64_t word;
+			std::memcpy(&word, &checkpoint.grid[i * sizeof(uint64_t)], sizeof(uint64_t));
+			occupancy[i].store(word, std::memory_order_relaxed);
+		}
+	}
+	return true;
+}
+
+/**
+* Writes the snapshot on its own thread.
+*/
+void Game::write_snapshot(){
+	if (!write_checkpoint(checkpoint_snapshot, checkpoint_path)){
+		std::cerr << "Could not write checkpoint to " << checkpoint_path << "." << std::endl;
+	}
+}
+
+/**
+* Snapshots the game into checkpoint_snapshot and writes it to a file.
+* Only the copy is made while the walkers are stopped, compressing and writing happen on checkpoint_writer.
+* A previous write still in progress is waited for first.
+* @param path: The file to write
+* @param iterations: Number of iterations run so far
+* @param wait: Whether to wait for the write to complete
+*/
+void Game::save_checkpoint(const std::string &path, uint64_t iterations, bool wait){
+	if (checkpoint_writer.joinable()){
+		checkpoint_writer.join();
+	}
+	checkpoint_path = path;
+	take_checkpoint(checkpoint_snapshot, iterations);
+	checkpoint_writer = std::thread(&Game::write_snapshot, this);
+	if (wait){
+		checkpoint_writer.join();
+	}
+}
+
+/**
+* Returns whether a checkpoint, such as a worker's, renders the same game as this one, so that its grid can be merged.
+*/
+bool Game::same_game(const Checkpoint &checkpoint){
+	size_t grid_size = grid_bytes();
+	return checkpoint.render_width == render_width && checkpoint.render_height == render_height
+		&& checkpoint.num_vertices == num_vertices && checkpoint.factor == factor && bool (checkpoint.density) == flag_density
+		&& checkpoint.vertices.size() == vertices.size()
+		&& std::memcmp(checkpoint.vertices.data(), vertices.data(), vertices.size() * sizeof(Vertex)) == 0
+		&& bool (checkpoint.ifs) == flag_ifs && checkpoint.ifs_weights == ifs_weights && checkpoint.ifs_restrict == ifs_restrict
+		&& checkpoint.ifs_file_maps.size() == ifs_file_maps.size()
+		&& std::memcmp(checkpoint.ifs_file_maps.data(), ifs_file_maps.data(), ifs_file_maps.size() * sizeof(AffineMap)) == 0
+		&& std::equal(ifs_frame, ifs_frame + 4, checkpoint.ifs_frame) && checkpoint.grid.size() == grid_size;
+}
+
+/**
+* Adds the raw bytes of a grid from a checkpoint of the same game into the grid: the marked cells of
+* occupancy grids, and the counts of density buffers, which saturate as they do while counting.
+*/
+void Game::merge_grid(const std::vector<uint8_t> &grid){
+	if (flag_density){
+		for (size_t i = 0; i < density.size(); i++){
+			DensityCount count;
+			std::memcpy(&count, &grid[i * sizeof(DensityCount)], sizeof(DensityCount));
+			uint64_t sum = uint64_t (density[i].load(std::memory_order_relaxed)) + count;
+			density[i].store(DensityCount (std::min(sum, uint64_t (DENSITY_MAX))), std::memory_order_relaxed);
+		}
+		return;
+	}
+	for (size_t i = 0; i < occupancy.size(); i++){
+		uint64_t word;
+		std::memcpy(&word, &grid[i * sizeof(uint64_t)], sizeof(uint64_t));
+		occupancy[i].store(occupancy[i].load(std::memory_order_relaxed) | word, std::memory_order_relaxed);
+	}
+}
+
+/**
+* Returns the number of cells of the grid with at least one hit.
+*/
+uint64_t Game::count_cells(){
+	uint64_t cells = 0;
+	if (flag_density){
+		for (size_t i = 0; i < density.size(); i++){
+			cells += density[i].load(std::memory_order_relaxed) != 0;
+		}
+		return cells;
+	}
+	for (size_t i = 0; i < occupancy.size(); i++){
+		cells += __builtin_popcountll(occupancy[i].load(std::memory_order_relaxed));
+	}
+	return cells;
+}
+
+/**
+* Returns the seed node k of a distributed render plays with: the game's seed for node 0, so that a single node
+* draws what a plain run would, and for the others the k-th output of a SplitMix64 generator seeded with it,
+* so that every node plays on streams of its own, whichever generator the walkers use.
+*/
+uint64_t node_seed(uint64_t seed, uint32_t node){
+	if (node == 0){
+		return seed;
+	}
+	SplitMix64 mixer;
+	mixer.seed(seed ^ 0x6A09E667F3BCC909, 0);
+	mixer.state += uint64_t (node - 1) * 0x9E3779B97F4A7C15;
+	return mixer.next();
+}
+
+}
+
+// Every ChaosEngine plays its own game, the engine's functions running on the state it holds
+
+using namespace chaos;
+
+struct ChaosEngine::State : Game {
+};
+
+const double ChaosEngine::MAX_ZOOM = 4096;
+const uint32_t ChaosEngine::MAX_SIZE;
+
+ChaosEngine::ChaosEngine() : state(new State()){
+}
+
+ChaosEngine::~ChaosEngine(){
+}
+
+std::unique_ptr<ChaosEngine> ChaosEngine::create(const ChaosConfig &config, std::string *error){
+	std::unique_ptr<ChaosEngine> engine(new ChaosEngine());
+	if (!engine->state->setup(config, error)){
+		return nullptr;
+	}
+	return engine;
+}
+
+bool ChaosEngine::reset(const ChaosConfig &config, std::string *error){
+	return state->setup(config, error);
+}
+
+uint64_t ChaosEngine::step(uint64_t iterations){
+	if (state->walkers.empty()){
+		return 0;
+	}
+	uint64_t done = state->run_walkers(iterations, RECORD_NONE);
+	state->iterations += done;
+	return done;
+}
+
+uint64_t ChaosEngine::step_walker(uint16_t walker, uint64_t iterations){
+	if (walker >= state->walkers.size()){
+		return 0;
+	}
+	Walker &stepped = state->walkers[walker];
+	uint64_t done = state->run_walker(stepped, iterations, state->recording);
+	stepped.iterations += done;
+	return done;
+}
+
+void ChaosEngine::start(){
+	state->start();
+}
+
+void ChaosEngine::stop(){
+	state->stop();
+}
+
+bool ChaosEngine::stopped() const{
+	return !state->playing();
+}
+
+void ChaosEngine::take_points(std::vector<ChaosPoint> &points){
+	points.reserve(points.size() + state->walkers.size() * state->pending_points());
+	for (size_t t = 0; t < state->walkers.size(); t++){
+		chaos::take_points(state->walkers[t], points);
+	}
+}
+
+void ChaosEngine::progress(uint64_t &iterations, uint64_t &points){
+	published_progress(state->walkers, iterations, points);
+	iterations += state->iterations;
+}
+
+void ChaosEngine::set_view(double center_x, double center_y, double zoom){
+	if (state->view_width == 0){
+		return;
+	}
+	bool running = !state->threads.empty();
+	if (running){
+		state->pause_walkers();
+	}
+	state->place_view(center_x, center_y, zoom);
+	for (size_t i = 0; i < state->view_occupancy.size(); i++){
+		state->view_occupancy[i].store(0, std::memory_order_relaxed);
+	}
+	for (size_t t = 0; t < state->walkers.size(); t++){
+		std::lock_guard<std::mutex> lock(state->walkers[t].mutex);
+		state->walkers[t].new_points.clear();
+		state->walkers[t].pending.clear();
+	}
+	if (running){
+		state->resume_walkers();
+	}
+}
+
+void ChaosEngine::view(double &center_x, double &center_y, double &zoom) const{
+	center_x = state->view_center_x;
+	center_y = state->view_center_y;
+	zoom = state->view_zoom;
+}
+
+uint64_t ChaosEngine::iterations() const{
+	return state->iterations + walker_iterations(state->walkers);
+}
+
+uint64_t ChaosEngine::unique_points() const{
+	uint64_t points = 0;
+	for (size_t t = 0; t < state->walkers.size(); t++){
+		points += state->walkers[t].num_points;
+	}
+	return points;
+}
+
+uint64_t ChaosEngine::cells() const{
+	return state->count_cells();
+}
+
+size_t ChaosEngine::grid_bytes() const{
+	return state->grid_bytes();
+}
+
+uint32_t ChaosEngine::width() const{
+	return state->render_width;
+}
+
+uint32_t ChaosEngine::height() const{
+	return state->render_height;
+}
+
+std::vector<ChaosVertex> ChaosEngine::vertices() const{
+	return state->vertices;
+}
+
+uint64_t ChaosEngine::burn_in() const{
+	return state->burn_in;
+}
+
+bool ChaosEngine::framebuffer(std::vector<uint32_t> &pixels, uint32_t width, uint32_t height, std::vector<uint32_t> *hits) const{
+	if (width == 0 || width > MAX_SIZE || height == 0 || height > MAX_SIZE){
+		return false;
+	}
+	state->render_pixels(pixels, width, height, hits);
+	return true;
+}
+
+bool ChaosEngine::write_image(const std::string &path) const{
+	bool png = path.size() >= 4 && path.compare(path.size() - 4, 4, ".png") == 0;
+	return state->write_image(path, png ? IMAGE_PNG : IMAGE_PPM);
+}
+
+bool ChaosEngine::write_image(const std::string &path, const std::string &format) const{
+	int index = find_name(IMAGE_FORMAT_NAMES, IMAGE_PNG + 1, format);
+	return index >= 0 && state->write_image(path, ImageFormat (index));
+}
+
+bool ChaosEngine::write_image(std::ostream &out, const std::string &format) const{
+	int index = find_name(IMAGE_FORMAT_NAMES, IMAGE_PNG + 1, format);
+	return index >= 0 && state->write_image(out, ImageFormat (index));
+}
+
+std::vector<uint8_t> ChaosEngine::snapshot() const{
+	Checkpoint checkpoint;
+	std::vector<uint8_t> data;
+	state->take_checkpoint(checkpoint, iterations());
+	encode_checkpoint(checkpoint, data);
+	return data;
+}
+
+bool ChaosEngine::restore(const std::vector<uint8_t> &snapshot){
+	Checkpoint checkpoint;
+	if (!decode_checkpoint(checkpoint, snapshot) || !state->same_game(checkpoint) || checkpoint.seed != state->seed
+		|| checkpoint.rng_kind != uint32_t (state->rng_kind)
+		|| logical_kernel(KernelKind (checkpoint.kernel_kind)) != logical_kernel(state->kernel_kind)
+		|| !state->restore_checkpoint(checkpoint)){
+		return false;
+	}
+	// The walkers' counts start over from the snapshot's iterations
+	state->iterations = checkpoint.iterations;
+	for (size_t t = 0; t < state->walkers.size(); t++){
+		Walker &walker = state->walkers[t];
+		walker.iterations = 0;
+		walker.published_iterations = 0;
+		walker.published_points = walker.num_points;
+		walker.pending.clear();
+	}
+	for (size_t i = 0; i < state->view_occupancy.size(); i++){
+		state->view_occupancy[i].store(0, std::memory_order_relaxed);
+	}
+	return true;
+}
+
+bool ChaosEngine::merge(const std::vector<uint8_t> &snapshot){
+	Checkpoint checkpoint;
+	if (!decode_checkpoint(checkpoint, snapshot) || !state->same_game(checkpoint)){
+		return false;
+	}
+	state->merge_grid(checkpoint.grid);
+	state->iterations += checkpoint.iterations;
+	return true;
+}
+
+void ChaosEngine::checkpoint(const std::string &path, bool wait){
+	if (state->threads.empty()){
+		state->save_checkpoint(path, iterations(), wait);
+		return;
+	}
+	// Walkers running since start are parked, so that the snapshot is consistent
+	if (state->pause_walkers()){
+		state->save_checkpoint(path, iterations(), wait);
+	}
+	state->resume_walkers();
+}
+
+void ChaosEngine::place_lanes(uint32_t count, std::vector<float> &points, std::vector<uint32_t> &states) const{
+	SplitMix64 expander;
+	expander.seed(state->seed, 0);
+	points.resize(size_t (count) * 2);
+	states.resize(size_t (count) * 4);
+	for (uint32_t i = 0; i < count; i++){
+		points[2 * i] = uniform_below(expander, state->render_width);
+		points[2 * i + 1] = uniform_below(expander, state->render_height);
+		states[4 * i] = expander.next_u32() | 1;
+		for (int w = 1; w < 4; w++){
+			states[4 * i + w] = expander.next_u32();
+		}
+	}
+}
+
+bool ChaosEngine::load_hits(const std::vector<uint32_t> &counts){
+	Game &game = *state;
+	if (game.flag_tiled || counts.size() != uint64_t (game.render_width) * game.render_height){
+		return false;
+	}
+	for (size_t i = 0; i < game.occupancy.size(); i++){
+		game.occupancy[i].store(0, std::memory_order_relaxed);
+	}
+	uint64_t points = 0;
+	for (uint32_t y = 0; y < game.render_height; y++){
+		for (uint32_t x = 0; x < game.render_width; x++){
+			uint32_t count = counts[size_t (y) * game.render_width + x];
+			if (game.flag_density){
+				game.density[game.density_index(x, y)].store(count, std::memory_order_relaxed);
+			}
+			else if (count > 0){
+				game.mark_index(uint64_t (y) * game.render_width + x);
+			}
+			points += count > 0;
+		}
+	}
+	// The cells hit are the game's unique points, which the first walker counts
+	for (size_t t = 0; t < game.walkers.size(); t++){
+		game.walkers[t].num_points = t == 0 ? points : 0;
+		game.walkers[t].published_points = game.walkers[t].num_points;
+	}
+	return true;
+}
+
+void ChaosEngine::interrupt(){
+	flag_interrupted = true;
+}
+
+bool ChaosEngine::interrupted(){
+	return flag_interrupted;
+}
+
+bool ChaosEngine::parse_number(const std::string &text, double &value){
+	return chaos::parse_number(text, value);
+}
+
+bool ChaosEngine::read_ifs(const std::string &path, ChaosConfig &config){
+	std::vector<AffineMap> maps;
+	std::vector<float> weights;
+	float frame[4];
+	if (!read_ifs_file(path, maps, weights, frame)){
+		return false;
+	}
+	config.maps = maps;
+	config.weights = weights;
+	std::copy(frame, frame + 4, config.frame);
+	config.vertices = maps.size();
+	return true;
+}
+
+std::string ChaosEngine::resolve_kernel(const std::string &name){
+	if (name == "simd"){
+		return KERNEL_NAMES[best_simd_kernel()];
+	}
+	return find_name(KERNEL_NAMES, KERNEL_LANES + 1, name) >= 0 ? name : std::string ();
+}
+
+bool ChaosEngine::kernel_supported(const std::string &name){
+	int kind = find_name(KERNEL_NAMES, KERNEL_LANES + 1, name);
+	return kind == KERNEL_SCALAR || kind == KERNEL_FIXED || (kind >= 0 && find_simd_kernel(KernelKind (kind)) != nullptr);
+}
+
+uint64_t ChaosEngine::node_seed(uint64_t seed, uint32_t node){
+	return chaos::node_seed(seed, node);
+}
+
+bool ChaosEngine::snapshot_config(const std::vector<uint8_t> &snapshot, ChaosConfig &config, uint64_t &iterations){
+	Checkpoint checkpoint;
+	if (!decode_checkpoint(checkpoint, snapshot)){
+		return false;
+	}
+	config.width = checkpoint.render_width;
+	config.height = checkpoint.render_height;
+	config.vertices = checkpoint.num_vertices;
+	config.fraction = checkpoint.factor;
+	config.density = checkpoint.density;
+	config.seed = checkpoint.seed;
+	config.rng = RNG_NAMES[checkpoint.rng_kind];
+	KernelKind kernel = logical_kernel(KernelKind (checkpoint.kernel_kind));
+	if (kernel == KERNEL_LANES && best_simd_kernel() != KERNEL_SCALAR){
+		kernel = best_simd_kernel();
+	}
+	config.kernel = KERNEL_NAMES[kernel];
+	config.weights = checkpoint.ifs_weights;
+	config.restricted = checkpoint.ifs_restrict;
+	config.maps = checkpoint.ifs_file_maps;
+	std::copy(checkpoint.ifs_frame, checkpoint.ifs_frame + 4, config.frame);
+	config.threads = checkpoint.walkers.size();
+	config.iterations = checkpoint.num_iterations;
+	iterations = checkpoint.iterations;
+	return true;
+}
+
+uint32_t ChaosEngine::argb(const uint8_t colour[3]){
+	return chaos::argb(colour);
+}
+
+uint32_t ChaosEngine::blend(float level){
+	return blend_argb(level);
+}
+
+uint32_t ChaosEngine::first_cell(uint32_t pixel, uint32_t pixels, uint32_t cells){
+	return chaos::first_cell(pixel, pixels, cells);
+}
+
+uint64_t ChaosEngine::process_allocations(){
+	return heap_allocations;
+}
+
+uint64_t ChaosEngine::thread_allocations(){
+	return chaos::thread_allocations;
+}
+
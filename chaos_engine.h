@@ -0,0 +1,318 @@
+// Embedding interface of the chaos game engine, for programs that drive the game themselves, such as the chaos
+// program's window and headless modes, benchmarks, fuzzers and services playing several games at once.
+// It needs neither SDL nor any header of the engine.
+
+#ifndef CHAOS_ENGINE_H
+#define CHAOS_ENGINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+* A cell of the grid, or a pixel of the zoomed view.
+*/
+struct ChaosPoint {
+	uint32_t x, y;
+};
+
+/**
+* A vertex of the game, in grid cells.
+*/
+struct ChaosVertex {
+	float x, y;
+};
+
+/**
+* An affine map of an IFS, (x, y) -> (a x + b y + e, c x + d y + f).
+*/
+struct ChaosMap {
+	float a, b, c, d, e, f;
+};
+
+// Drawn colours, as RGB
+const uint8_t CHAOS_BACKGROUND[3] = {0x00, 0x00, 0x00};
+const uint8_t CHAOS_VERTICES[3] = {0xFF, 0x10, 0x10};
+const uint8_t CHAOS_POINTS[3] = {0x30, 0x90, 0x80};
+
+/**
+* Parameters of the game played by a ChaosEngine. The defaults are those of the chaos program.
+*/
+struct ChaosConfig {
+	uint32_t width = 1000;              // Render grid width in cells
+	uint32_t height = 1000;             // Render grid height in cells
+	uint16_t vertices = 3;              // Number of vertices in the polygon, from 3 to 255, ignored with maps
+	float fraction = 0.5;               // Fraction of the distance to the chosen vertex, between 0 and 1
+	uint16_t threads = 1;               // Number of walkers, each stepped on its own thread
+	uint64_t seed = 0;                  // Seed of the walkers' random streams
+	bool density = false;               // Count hits per cell instead of marking cells
+	std::string tone = "log";           // Tone mapping of the density counts: log or gamma
+	float gamma = 2.2;                  // Gamma of the gamma tone mapping
+	uint32_t supersample = 1;           // Cells averaged into each pixel of written images along each axis
+	std::string kernel = "scalar";      // Step kernel: scalar, simd (the widest on the CPU), sse4, avx2, avx512, neon, fixed or lanes
+	std::string rng = "xoshiro256";     // Random number generator: xoshiro256, pcg32 or splitmix
+	int64_t burn_in = -1;               // Iterations every walker runs before its first point, -1 for enough to reach the attractor
+
+	// Generalized IFS, run on the scalar kernel when any of these is given: weights of choosing each vertex,
+	// ignored unless there is one per vertex, offsets from the previous vertex that are never chosen, and maps
+	// that replace the polygon's, in coordinates of frame (x0, y0, x1, y1), y growing upwards
+	std::vector<float> weights;
+	std::vector<uint16_t> restricted;
+	std::vector<ChaosMap> maps;
+	float frame[4] = {0, 0, 1, 1};
+
+	uint64_t stepping = 2500;           // Iterations a walker runs between handing over its points, once started
+	bool record_points = false;         // Hand the new points over to take_points, for a window drawing them as they come
+	uint32_t view_width = 0;            // Size in pixels of the zoomed view of set_view, 0 for none
+	uint32_t view_height = 0;
+	std::string tile_file;              // Keeps the grid out of core in this file of tiles, unless empty
+	uint64_t tile_memory = uint64_t (1024) << 20;  // Bytes of tiles mapped at a time
+	std::string stream;                 // Streams the generated points to this file, a pipe or stdout ("-"), unless empty
+	std::string stream_format = "raw";  // Records of the point stream: raw or varint
+	bool stream_all = false;            // Stream every iteration instead of only the new points
+	uint64_t iterations = 10000000;     // Iterations the game is meant to run, saved in snapshots
+};
+
+/**
+* A chaos game stepped by its caller, on the same engine as the chaos program: the same seed and parameters give
+* the same grid. Every ChaosEngine plays a game of its own, its grid, walkers and buffers held in its own state,
+* so any number of them may run at once, each on threads of its caller. Methods of one engine may be called from
+* any thread. The const methods only read the game, so any number of them may run at once, but none while a
+* method that changes it runs, and those never run concurrently with each other, except while the walkers run
+* continuously between start and stop: then take_points, progress, set_view, checkpoint and framebuffer, which
+* reads the grid as the walkers fill it, may be called from the thread that started them, alongside the const
+* methods that do not read the grid.
+*/
+class ChaosEngine {
+public:
+	// Largest magnification of set_view over the whole grid
+	static const double MAX_ZOOM;
+
+	// Largest dimension of the grid and of rendered images. Points are floats, which hold every cell exactly up to it.
+	static const uint32_t MAX_SIZE = 1 << 24;
+
+	/**
+	* Sets up a game, its grid empty and its walkers placed and burnt in, and opens its tile file and point stream.
+	* @param error: Receives why the game could not be set up, unless nullptr
+	* @return nullptr if the configuration is invalid or a file could not be opened.
+	*/
+	static std::unique_ptr<ChaosEngine> create(const ChaosConfig &config, std::string *error = nullptr);
+
+	// Ends the game, stopping its walkers and closing its files. Not concurrent with any other method.
+	~ChaosEngine();
+
+	/**
+	* Sets up a new game in place of this one, as create does, reusing the memory of its grid and buffers when the
+	* new game fits in it. Not concurrent with any other method.
+	* @return false if the configuration is invalid or a file could not be opened, in which case the engine holds
+	* no game until it is reset again.
+	*/
+	bool reset(const ChaosConfig &config, std::string *error = nullptr);
+
+	/**
+	* Runs a number of iterations, split between the walkers on threads of their own, and returns once they
+	* have all stopped. Not concurrent with any other method.
+	* @return The number of iterations run, fewer than asked if the game was stopped or the process interrupted.
+	*/
+	uint64_t step(uint64_t iterations);
+
+	/**
+	* Runs one walker for a number of iterations on the calling thread, so that a caller may time the walkers on
+	* threads of its own. Walkers may be stepped side by side, but not with any other method.
+	* @return The number of iterations run.
+	*/
+	uint64_t step_walker(uint16_t walker, uint64_t iterations);
+
+	/**
+	* Runs every walker continuously on a thread of its own, handing its new points over every stepping
+	* iterations, until stop. Not concurrent with any other method.
+	*/
+	void start();
+
+	// Stops the game, and the walkers started by start once they are done with their step
+	void stop();
+
+	// Whether the game was stopped, by stop, a failed point stream or an interrupt
+	bool stopped() const;
+
+	/**
+	* Appends the points the walkers handed over since the last call, with record_points. Points are grid cells,
+	* or pixels of the view while it is zoomed in. Room for every point the walkers may hold is reserved up front.
+	*/
+	void take_points(std::vector<ChaosPoint> &points);
+
+	// Iterations run and unique points found by the walkers, as they last handed over their points
+	void progress(uint64_t &iterations, uint64_t &points);
+
+	/**
+	* Shows a zoomed view of the grid, at a zoom around a centre in grid cells, the whole grid for a zoom of 1.
+	* While zoomed in, the walkers only hand over the new pixels of the view. The walkers running since start are
+	* parked while the view changes, and the points they have not handed over yet are dropped. Does nothing
+	* without a view_width.
+	*/
+	void set_view(double center_x, double center_y, double zoom);
+
+	// The view of set_view, clamped to the grid and to MAX_ZOOM
+	void view(double &center_x, double &center_y, double &zoom) const;
+
+	// Number of iterations run so far. Reads the game, like every const method
+	uint64_t iterations() const;
+
+	// Number of distinct cells discovered so far, summed over the walkers
+	uint64_t unique_points() const;
+
+	// Number of cells of the grid hit at least once, which counts the grids merged into it. Reads the grid
+	uint64_t cells() const;
+
+	// Size in bytes of the grid in a snapshot, before compression
+	size_t grid_bytes() const;
+
+	// Dimensions of the grid in cells
+	uint32_t width() const;
+	uint32_t height() const;
+
+	// Vertices of the game, in grid cells
+	std::vector<ChaosVertex> vertices() const;
+
+	// Iterations every walker ran before its first point
+	uint64_t burn_in() const;
+
+	/**
+	* Renders the grid into ARGB pixels, as the window and exported images show it. Reads the grid.
+	* @param pixels: Resized to width * height pixels, in rows
+	* @param width: Width of the image, which the grid is downsampled to; pixels without a cell of their own are background
+	* @param height: Height of the image
+	* @param hits: Receives the number of marked cells, or the sum of the hit counts, of every pixel, unless nullptr
+	* @return false if the size is out of range.
+	*/
+	bool framebuffer(std::vector<uint32_t> &pixels, uint32_t width, uint32_t height, std::vector<uint32_t> *hits = nullptr) const;
+
+	/**
+	* Writes the grid, downsampled by supersample, and the vertices to an image, encoding bands of it on threads
+	* of its own: PNG if path ends in .png and PPM otherwise. Reads the grid.
+	* @return false if the image could not be written.
+	*/
+	bool write_image(const std::string &path) const;
+
+	// Writes the image in a format, ppm or png, to a file or an open stream
+	bool write_image(const std::string &path, const std::string &format) const;
+	bool write_image(std::ostream &out, const std::string &format) const;
+
+	/**
+	* Returns the game, parameters, walkers and grid, in the format of the chaos program's checkpoint files.
+	* Reads the grid.
+	*/
+	std::vector<uint8_t> snapshot() const;
+
+	/**
+	* Rewinds the game to a snapshot of the same game: same parameters and number of walkers. The SIMD and lanes
+	* kernels count as one, as they draw the same points.
+	* Not concurrent with any other method.
+	* @return false if the snapshot is invalid or of another game, in which case the game is unchanged.
+	*/
+	bool restore(const std::vector<uint8_t> &snapshot);
+
+	/**
+	* Adds the grid of a snapshot of the same game, such as one played from another seed, to this one's, and its
+	* iterations to this one's. Not concurrent with any other method.
+	* @return false if the snapshot is invalid or of another game, in which case the game is unchanged.
+	*/
+	bool merge(const std::vector<uint8_t> &snapshot);
+
+	/**
+	* Writes a snapshot of the game to a file, through a temporary file that replaces it once complete. The walkers
+	* running since start are parked while it is taken, and the file is written in the background, after the
+	* snapshot written before it. Failures are reported on stderr.
+	* @param wait: Whether to wait for the file to be written
+	*/
+	void checkpoint(const std::string &path, bool wait);
+
+	/**
+	* Places walkers for a frontend that runs them itself, such as on the GPU, as the SIMD lanes are placed,
+	* from one stream of the seed: count points on the grid and xoshiro128+ states, whose first word is odd.
+	* @param points: Receives count x, y pairs
+	* @param states: Receives count states of four words
+	*/
+	void place_lanes(uint32_t count, std::vector<float> &points, std::vector<uint32_t> &states) const;
+
+	/**
+	* Loads hit counts, one per cell in rows, into the grid, such as those a frontend accumulated on the GPU,
+	* marking the cells hit or storing their counts, in place of the grid's, whose cells and unique points are
+	* cleared first. Not concurrent with any other method.
+	* @return false if there is not one count per cell, or the grid is tiled, in which case the game is unchanged.
+	*/
+	bool load_hits(const std::vector<uint32_t> &counts);
+
+	// Stops every game of the process, as SIGINT does the chaos program's. Async-signal-safe
+	static void interrupt();
+
+	// Whether interrupt was called
+	static bool interrupted();
+
+	/**
+	* Parses a whole string as a finite number, unlike atof, which reads "x" or "1x" as a number.
+	* @return false if the text is empty, not a number, or has trailing characters, in which case value is unchanged.
+	*/
+	static bool parse_number(const std::string &text, double &value);
+
+	/**
+	* Reads the maps of an IFS from a file, one map per line as "weight a b c d e f", with an optional line
+	* "frame x0 y0 x1 y1" giving the region of the plane that is rendered, y growing upwards. Text after # is ignored.
+	* @return true if between 1 and 255 maps with a positive total weight were read, in which case the maps,
+	* weights, frame and vertices of config are set.
+	*/
+	static bool read_ifs(const std::string &path, ChaosConfig &config);
+
+	/**
+	* Resolves the name of a step kernel: simd to the widest SIMD kernel of this CPU, the others to themselves.
+	* @return The kernel's name, or an empty string if there is no such kernel.
+	*/
+	static std::string resolve_kernel(const std::string &name);
+
+	// Whether this CPU and build run a step kernel
+	static bool kernel_supported(const std::string &name);
+
+	/**
+	* Returns the seed node k of a distributed render plays with: the game's seed for node 0, so that a single node
+	* draws what a plain run would, and a SplitMix64 output of it for the others, so that no two nodes share a stream.
+	*/
+	static uint64_t node_seed(uint64_t seed, uint32_t node);
+
+	/**
+	* Reads the parameters of the game of a snapshot into config, which create then sets the game up for. A game of a
+	* SIMD or the lanes kernel gets the best SIMD kernel of this CPU, or lanes if it has none.
+	* @param iterations: Receives the number of iterations the snapshot was taken after
+	* @return false if the snapshot is invalid, in which case config is unchanged.
+	*/
+	static bool snapshot_config(const std::vector<uint8_t> &snapshot, ChaosConfig &config, uint64_t &iterations);
+
+	// Packs an RGB colour into an ARGB8888 pixel
+	static uint32_t argb(const uint8_t colour[3]);
+
+	// Blends CHAOS_BACKGROUND towards CHAOS_POINTS, from a level of 0 to 1, as the grid is rendered
+	static uint32_t blend(float level);
+
+	/**
+	* Returns the first of the cells, along one axis of size cells, that fall in a pixel of a downsampled image.
+	* @param pixel: The pixel, pixels for the end of the last pixel
+	* @param pixels: Size of the downsampled image along the axis
+	*/
+	static uint32_t first_cell(uint32_t pixel, uint32_t pixels, uint32_t cells);
+
+	// Heap allocations made by the process and by the calling thread, counted by a program that links allocations.cpp
+	static uint64_t process_allocations();
+	static uint64_t thread_allocations();
+
+private:
+	struct State;
+	std::unique_ptr<State> state;
+
+	ChaosEngine();
+	ChaosEngine(const ChaosEngine &) = delete;
+	ChaosEngine &operator=(const ChaosEngine &) = delete;
+};
+
+#endif
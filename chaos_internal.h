@@ -0,0 +1,710 @@
+// Internals of the chaos game engine, shared between chaos_engine.cpp and the white-box microbenchmarks: the
+// engine's types, and the Game, the parameters and state of one game, which every ChaosEngine holds its own of.
+// Besides the interrupt flag and the allocation counters, the engine keeps no state of its own.
+
+#ifndef CHAOS_INTERNAL_H
+#define CHAOS_INTERNAL_H
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <list>
+#include <type_traits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "chaos_engine.h"
+
+namespace chaos {
+
+typedef ChaosVertex Vertex;
+typedef ChaosPoint Point;
+
+// Walker coordinates are floats, which hold every cell exactly up to 2^24
+const uint32_t MAX_RENDER_SIZE = ChaosEngine::MAX_SIZE;
+
+// Generalized IFS, with weights, restricted offsets or maps: instead of moving towards a uniformly chosen
+// vertex, walkers apply the affine map of a vertex chosen by weight, (x, y) -> (a x + b y + e, c x + d y + f)
+// in render space. The polygon's maps move towards its vertices by factor, maps read from a file are given
+// in coordinates of a frame that is mapped to the grid, and their fixed points become the vertices.
+// Restricted offsets from the previous vertex are never chosen, 0 forbids repeating it. Each previous vertex
+// has its own alias table, of num_vertices thresholds and aliases, so a choice takes one random number.
+typedef ChaosMap AffineMap;
+
+/**
+* Memory of a game's buffers, the grid and the points handed from the walkers to the caller, allocated up front
+* by Game::setup_game from one mapping sized from the dimensions, so that nothing is allocated or copied while
+* the game runs. The mapping is on huge pages when the system has them reserved, and advised to use transparent
+* huge pages otherwise. Its blocks are released all at once, when the next game rewinds it. A full arena falls
+* back to the heap.
+*/
+struct Arena {
+	uint8_t *base;
+	size_t capacity, used;
+	bool huge_pages;
+	std::mutex mutex;
+
+	Arena() : base(nullptr), capacity(0), used(0), huge_pages(false){}
+	~Arena();
+	Arena(const Arena &) = delete;
+	Arena &operator=(const Arena &) = delete;
+
+	void map(size_t size);
+	void *allocate(size_t size);
+	void release(void *block);
+};
+
+/**
+* Allocator of the containers whose storage comes from an arena, or from the heap without one.
+* Containers take their allocator along when they are assigned or swapped, so that a buffer swapped into
+* a member of a game is released to the arena it came from.
+*/
+template <class T>
+struct ArenaAllocator {
+	typedef T value_type;
+	typedef std::true_type propagate_on_container_copy_assignment;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+	Arena *arena;
+
+	ArenaAllocator() : arena(nullptr){}
+	explicit ArenaAllocator(Arena *arena) : arena(arena){}
+	template <class U>
+	ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena){}
+	T *allocate(size_t n){
+		return static_cast<T *>(arena != nullptr ? arena->allocate(n * sizeof(T)) : ::operator new(n * sizeof(T)));
+	}
+	void deallocate(T *block, size_t){
+		if (arena != nullptr){
+			arena->release(block);
+		}
+		else{
+			::operator delete(block);
+		}
+	}
+};
+
+template <class T, class U>
+bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b){
+	return a.arena == b.arena;
+}
+
+template <class T, class U>
+bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b){
+	return a.arena != b.arena;
+}
+
+template <class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+// How walkers record the points they discover
+enum Recording { RECORD_NONE, RECORD_POINTS };
+
+// Density mode counts the hits on every cell instead of marking it, and tone maps the counts when rendering.
+// Counts are 32 bits, so that long runs keep adding information instead of saturating, and are stored in tiles of
+// DENSITY_TILE x DENSITY_TILE cells, so that hits close together land in the same few cache lines.
+typedef uint32_t DensityCount;
+const DensityCount DENSITY_MAX = UINT32_MAX;
+const uint32_t DENSITY_TILE = 8;
+enum ToneKind { TONE_LOG, TONE_GAMMA };
+extern const char *TONE_NAMES[];
+
+// Images are written as binary PPM, the fastest, or PNG, the smallest.
+// Bands of EXPORT_BAND_ROWS rows are encoded in parallel, PNG bands deflated at PNG_LEVEL.
+enum ImageFormat { IMAGE_PPM, IMAGE_PNG };
+extern const char *IMAGE_FORMAT_NAMES[];
+
+// Heap allocations made by the process and by the current thread, for the bench report. The library only holds
+// the counters: a program counts into them by linking allocations.cpp, whose operator new replaces the global
+// one, and without it they stay at 0.
+extern std::atomic<uint64_t> heap_allocations;
+extern thread_local uint64_t thread_allocations;
+
+// Stream mode writes the points the walkers generate to a file, a pipe or stdout ("-"), as a header
+// followed by chunks of packed (x, y, vertex) records. Records are either raw, or zigzag varint deltas
+// from the previous record of their chunk. Every iteration or only newly discovered points are streamed.
+enum StreamFormat { STREAM_RAW, STREAM_VARINT };
+extern const char *STREAM_FORMAT_NAMES[];
+
+/**
+* SplitMix64 generator. Streams are 2^48 draws apart on the same Weyl sequence.
+*/
+struct SplitMix64 {
+	uint64_t state;
+
+	void seed(uint64_t seed, uint64_t stream){
+		state = seed + stream * (uint64_t (0x9E3779B97F4A7C15) << 48);
+	}
+
+	inline uint64_t next(){
+		uint64_t z = (state += 0x9E3779B97F4A7C15);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+		return z ^ (z >> 31);
+	}
+
+	inline uint32_t next_u32(){
+		return next() >> 32;
+	}
+};
+
+/**
+* xoshiro256** generator. Streams are 2^128 draws apart, using the generator's jump function.
+*/
+struct Xoshiro256 {
+	uint64_t s[4];
+
+	static inline uint64_t rotl(uint64_t x, int k){
+		return (x << k) | (x >> (64 - k));
+	}
+
+	void seed(uint64_t seed, uint64_t stream){
+		SplitMix64 expander;
+		expander.seed(seed, 0);
+		for (int i = 0; i < 4; i++){
+			s[i] = expander.next();
+		}
+		for (uint64_t i = 0; i < stream; i++){
+			jump();
+		}
+	}
+
+	void jump(){
+		static const uint64_t JUMP[] = {0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c};
+		uint64_t t[4] = {0, 0, 0, 0};
+		for (int i = 0; i < 4; i++){
+			for (int b = 0; b < 64; b++){
+				if (JUMP[i] & uint64_t (1) << b){
+					for (int j = 0; j < 4; j++){
+						t[j] ^= s[j];
+					}
+				}
+				next();
+			}
+		}
+		for (int j = 0; j < 4; j++){
+			s[j] = t[j];
+		}
+	}
+
+	inline uint64_t next(){
+		uint64_t result = rotl(s[1] * 5, 7) * 9;
+		uint64_t t = s[1] << 17;
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = rotl(s[3], 45);
+		return result;
+	}
+
+	inline uint32_t next_u32(){
+		return next() >> 32;
+	}
+};
+
+/**
+* PCG32 (XSH RR) generator. Each stream uses its own increment.
+*/
+struct Pcg32 {
+	uint64_t state;
+	uint64_t inc;
+
+	void seed(uint64_t seed, uint64_t stream){
+		state = 0;
+		inc = (stream << 1) | 1;
+		next_u32();
+		state += seed;
+		next_u32();
+	}
+
+	inline uint32_t next_u32(){
+		uint64_t old = state;
+		state = old * 6364136223846793005 + inc;
+		uint32_t xorshifted = ((old >> 18) ^ old) >> 27;
+		uint32_t rot = old >> 59;
+		return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+	}
+};
+
+// SIMD kernels advance SIMD_LANES walkers at once, in SoA layout, each lane with its own
+// xoshiro128+ stream. Every step writes one point per lane.
+const int SIMD_LANES = 16;
+
+/**
+* State of the SIMD_LANES walkers advanced together by a SIMD kernel.
+*/
+struct SimdLanes {
+	float x[SIMD_LANES], y[SIMD_LANES];
+	uint32_t s0[SIMD_LANES], s1[SIMD_LANES], s2[SIMD_LANES], s3[SIMD_LANES];
+};
+
+/**
+* Parameters of the step rule shared by every SIMD kernel call.
+* vertex_x and vertex_y hold the vertex coordinates in SoA layout, for gathers.
+*/
+struct SimdParams {
+	const float *vertex_x;
+	const float *vertex_y;
+	uint32_t num_vertices;
+	float factor;
+	uint32_t die_threshold;  // (2^32 - num_vertices) % num_vertices, for rolling the die without bias
+};
+
+/**
+* Advances every lane by a number of steps.
+* @param lanes: The walkers to advance, updated in place
+* @param params: The step rule
+* @param xs: Receives steps * SIMD_LANES x coordinates, in step order
+* @param ys: Receives steps * SIMD_LANES y coordinates, in step order
+* @param vs: Receives steps * SIMD_LANES chosen vertices, in step order, unless nullptr
+* @param steps: Number of steps to run
+*/
+typedef void (*SimdKernel)(SimdLanes &lanes, const SimdParams &params, uint32_t *xs, uint32_t *ys, uint32_t *vs, size_t steps);
+
+// The lanes kernel runs the SIMD step rule one lane at a time, as the reference the SIMD kernels are tested against
+enum KernelKind { KERNEL_SCALAR, KERNEL_SSE4, KERNEL_AVX2, KERNEL_AVX512, KERNEL_NEON, KERNEL_FIXED, KERNEL_LANES };
+extern const char *KERNEL_NAMES[];
+
+enum RngKind { RNG_XOSHIRO256, RNG_PCG32, RNG_SPLITMIX };
+extern const char *RNG_NAMES[];
+
+/**
+* A single player of the game: its current point, random number stream and discoveries, and in IFS mode
+* the vertex it chose last. Only the generator selected by rng_kind is seeded and used. The fixed kernel keeps
+* the point in Q32.32 as well, in fixed_x and fixed_y, and x and y follow it.
+* Discovered points collect in new_points and are published to pending, which the caller takes under mutex,
+* along with the walker's iterations and unique points at the time. Both are reserved up front in the game's
+* arena, new_points for a step and pending for pending_points points, and never grow.
+*/
+struct Walker {
+	float x, y;
+	SplitMix64 splitmix;
+	Xoshiro256 xoshiro;
+	Pcg32 pcg;
+	SimdLanes lanes;
+	uint64_t num_points;
+	uint64_t iterations;
+	std::vector<uint64_t> bin, sorted_bin;
+	std::vector<uint32_t> tile_starts;
+	uint32_t index;
+	std::vector<uint8_t> stream_buffer;
+	uint32_t stream_records;
+	uint32_t stream_x, stream_y;
+	ArenaVector<Point> new_points;
+	std::mutex mutex;
+	ArenaVector<Point> pending;
+	uint64_t published_iterations, published_points;
+	uint32_t vertex;
+	uint64_t fixed_x, fixed_y;
+};
+
+/**
+* State of a walker saved in a checkpoint.
+*/
+struct WalkerState {
+	float x, y;
+	SplitMix64 splitmix;
+	Xoshiro256 xoshiro;
+	Pcg32 pcg;
+	SimdLanes lanes;
+	uint64_t num_points;
+	uint32_t vertex;
+	uint64_t fixed_x, fixed_y;
+};
+
+/**
+* Everything needed to resume a game: its parameters, vertices, IFS rules, walkers and grid,
+* the raw bytes of the occupancy grid or the density buffer.
+*/
+struct Checkpoint {
+	uint32_t render_width, render_height;
+	uint16_t num_vertices;
+	float factor;
+	uint8_t density;
+	uint64_t seed;
+	uint32_t rng_kind, kernel_kind;
+	uint64_t iterations, num_iterations;
+	std::vector<Vertex> vertices;
+	uint8_t ifs;
+	std::vector<float> ifs_weights;
+	std::vector<uint16_t> ifs_restrict;
+	std::vector<AffineMap> ifs_file_maps;
+	float ifs_frame[4];
+	std::vector<WalkerState> walkers;
+	std::vector<uint8_t> grid;
+};
+
+/**
+* Sums and cell counts of the pixels of a row being rendered. Every thread that renders keeps one, whose buffers
+* keep their capacity from row to row and render to render, so that drawing frame after frame allocates nothing.
+*/
+struct RowScratch {
+	std::vector<uint64_t> sums;
+	std::vector<uint32_t> cells;
+};
+
+// Set by ChaosEngine::interrupt, stops the walkers of every game in the process
+extern std::atomic<bool> flag_interrupted;
+
+// Readers of the tile file and rows of exported images, defined in chaos_engine.cpp
+struct TileCursor;
+struct ImageExport;
+
+/**
+* The parameters and state of one game, set up from a ChaosConfig: its vertices, grid, walkers, files and arena.
+* A game's walkers only touch the game's own state, so games running side by side share nothing but the process.
+*/
+struct Game {
+	// The arena comes first, so that it outlives every buffer allocated from it
+	Arena arena;
+
+	// Render properties: the walkers play on a render_width x render_height grid of cells.
+	// Written images average supersample x supersample cells into each pixel.
+	uint32_t render_width, render_height;
+	uint32_t supersample;
+
+	// Parameters of the Chaos Game
+	uint16_t num_vertices;
+	float factor;
+	std::vector<Vertex> vertices;
+	std::vector<float> vertex_x, vertex_y;
+
+	// Fixed-point copies of the vertex coordinates, with FIXED_SHIFT fractional bits, for the loops
+	// specialized for a fraction of 0.5, which halve the distance to a vertex with an add and a shift
+	std::vector<uint64_t> vertex_fixed_x, vertex_fixed_y;
+
+	// Q32.32 copies of the vertex coordinates and of the fraction, for the fixed kernel, which moves its walkers
+	// in integers only, so that a seed gives the same points on every compiler, CPU and instruction set
+	std::vector<uint64_t> vertex_q32_x, vertex_q32_y;
+	uint64_t factor_q32;
+
+	// Generalized IFS: the rules it was given, and the maps and alias tables built from them
+	bool flag_ifs;
+	std::vector<float> ifs_weights;
+	std::vector<uint16_t> ifs_restrict;
+	std::vector<AffineMap> ifs_file_maps;
+	float ifs_frame[4];
+	std::vector<AffineMap> ifs_maps;
+	std::vector<uint32_t> alias_threshold, alias_other;
+
+	// Zoom and pan: while the view is zoomed in, the walkers still run over the whole attractor, but only
+	// record the points inside the view, a view_width x view_height image, in view_occupancy, which is reset
+	// whenever the view changes so that the view refines progressively. The view is centred on
+	// (view_center_x, view_center_y) in render cells, magnified view_zoom times over the whole grid; the walkers
+	// map their points by its top left corner (view_x0, view_y0) and view_scale, in view pixels per cell.
+	// Points are floats, which on a grid of about a thousand cells stop resolving the pixels of a view much
+	// beyond ChaosEngine::MAX_ZOOM.
+	uint32_t view_width, view_height;
+	bool flag_zoomed;
+	double view_center_x, view_center_y, view_zoom;
+	float view_x0, view_y0, view_scale;
+	ArenaVector<std::atomic<uint64_t>> view_occupancy;
+
+	// Occupancy grid, one bit per cell, sized from the render dimensions.
+	// Words are updated atomically so that walkers on several threads can share the grid.
+	ArenaVector<std::atomic<uint64_t>> occupancy;
+
+	// Density buffer, in tiles of DENSITY_TILE x DENSITY_TILE cells, and the tone mapping of its counts
+	bool flag_density;
+	ToneKind tone_kind;
+	float gamma_value;
+	ArenaVector<std::atomic<DensityCount>> density;
+	uint32_t density_tiles_x;
+
+	// Tiled mode keeps the occupancy grid or density buffer out of core, in a file of tiles of
+	// 2^TILE_SHIFT x 2^TILE_SHIFT cells, of which at most tile_memory bytes are mapped at a time.
+	// Walkers bin their points and flush them a tile at a time, least recently used tiles are unmapped.
+	bool flag_tiled;
+	std::string tile_path;
+	uint64_t tile_memory;
+	int tile_fd;
+	uint32_t tiles_x, tiles_y;
+	size_t tile_bytes;
+	std::vector<uint8_t *> tile_maps;
+	std::list<uint32_t> tile_lru;
+	std::vector<std::list<uint32_t>::iterator> tile_lru_pos;
+	uint64_t tile_evictions;
+	std::mutex tile_mutex;
+
+	// Walkers running continuously hand their new points over every stepping iterations.
+	// num_iterations is the length of the game, which only snapshots record.
+	uint64_t stepping;
+	uint64_t num_iterations;
+
+	// The point stream
+	bool flag_stream;
+	bool flag_stream_all;
+	StreamFormat stream_format;
+	std::string stream_path;
+	int stream_fd;
+	std::mutex stream_mutex;
+
+	// Walkers play the game independently, one per thread, each with its own random number stream
+	uint16_t num_threads;
+	RngKind rng_kind;
+	uint64_t seed;
+	KernelKind kernel_kind;
+	SimdKernel simd_kernel;
+
+	// Every walker and SIMD lane runs burn_in iterations without recording them before its first point,
+	// so that it starts on the attractor. Unless set, enough for the distance to the attractor to shrink below a cell.
+	uint64_t burn_in;
+	bool flag_burn_in_set;
+
+	// Rejection threshold for rolling the die without bias, (2^32 - num_vertices) % num_vertices
+	uint32_t die_threshold;
+
+	/**
+	* A scalar loop, as selected by find_walker_loop.
+	*/
+	typedef uint64_t (Game::*WalkerLoop)(Walker &walker, uint64_t iterations, Recording recording);
+
+	// Scalar loop for the current parameters, selected by setup_game
+	WalkerLoop walker_loop;
+
+	// flag_continue dictates the continuation of the game. Pause handshake: the caller sets flag_pause and waits
+	// until every walker has parked in simulate, so that it can read a consistent grid and walker state.
+	std::atomic<bool> flag_continue;
+	std::atomic<bool> flag_pause;
+	std::mutex pause_mutex;
+	std::condition_variable pause_cv;
+	size_t walkers_paused;
+
+	// The walkers, how they record their points and the threads running them in simulate, and the iterations
+	// the game ran before the walkers' own counts, which start over when a snapshot is restored
+	std::vector<Walker> walkers;
+	Recording recording;
+	std::vector<std::thread> threads;
+	uint64_t iterations;
+
+	// Snapshot being written by checkpoint_writer to checkpoint_path, which is joined before the next snapshot is taken
+	Checkpoint checkpoint_snapshot;
+	std::thread checkpoint_writer;
+	std::string checkpoint_path;
+
+	Game();
+	~Game();
+	Game(const Game &) = delete;
+	Game &operator=(const Game &) = delete;
+
+	/**
+	* Whether the walkers go on: the game was not stopped, and the process not interrupted.
+	*/
+	inline bool playing() const{
+		return flag_continue && !flag_interrupted;
+	}
+
+	/**
+	* Marks the cell at index y * render_width + x in the occupancy grid.
+	* @return true if the cell was not marked before.
+	*/
+	inline bool mark_index(uint64_t index){
+		std::atomic<uint64_t> &word = occupancy[index >> 6];
+		uint64_t mask = uint64_t (1) << (index & 63);
+		// Most points are already marked, so only pay for the atomic update when the bit looks clear
+		if (word.load(std::memory_order_relaxed) & mask){
+			return false;
+		}
+		return (word.fetch_or(mask, std::memory_order_relaxed) & mask) == 0;
+	}
+
+	/**
+	* Returns the position of the cell at (x, y) in the tiled density buffer.
+	*/
+	inline uint64_t density_index(uint32_t x, uint32_t y) const{
+		uint64_t tile = uint64_t (y / DENSITY_TILE) * density_tiles_x + x / DENSITY_TILE;
+		return tile * DENSITY_TILE * DENSITY_TILE + (y % DENSITY_TILE) * DENSITY_TILE + x % DENSITY_TILE;
+	}
+
+	// Functions of the game, documented where chaos_engine.cpp defines them
+	bool setup(const ChaosConfig &config, std::string *error);
+	void teardown();
+	void start();
+	void stop();
+
+	bool mark_view_point(uint32_t x, uint32_t y);
+	bool mark_point(uint32_t x, uint32_t y);
+	bool add_hit(uint32_t x, uint32_t y);
+	bool open_tile_store();
+	void close_tile_store();
+	uint8_t *acquire_tile(uint32_t tile);
+	uint32_t tiled_cell(TileCursor &cursor, uint32_t x, uint32_t y);
+	void flush_bin(Walker &walker);
+	void bin_point(Walker &walker, uint32_t x, uint32_t y);
+	bool plot_point(Walker &walker, uint32_t x, uint32_t y);
+
+	void fill_vertex_arrays();
+	AffineMap frame_to_render(const AffineMap &map);
+	Vertex fixed_point(const AffineMap &map);
+	void create_file_vertices();
+	void create_vertices();
+	void create_ifs();
+
+	bool write_stream(const uint8_t *data, size_t size);
+	bool open_stream();
+	void close_stream();
+	void flush_stream(Walker &walker);
+	void stream_point(Walker &walker, uint32_t x, uint32_t y, uint32_t vertex);
+
+	template <class Rng> void place_walker(Walker &walker, Rng &rng);
+	template <class Rng> void warm_up_point(Walker &walker, uint64_t iterations);
+	void warm_up_walker(Walker &walker);
+	uint64_t pending_points();
+	void create_walkers();
+
+	template <class Rng, bool Streaming, int Vertices, bool Half>
+	uint64_t run_walker_loop(Walker &walker, uint64_t iterations, Recording recording);
+	template <class Rng, bool Streaming>
+	uint64_t run_ifs_loop(Walker &walker, uint64_t iterations, Recording recording);
+	template <class Rng, bool Streaming>
+	uint64_t run_fixed_loop(Walker &walker, uint64_t iterations, Recording recording);
+	template <class Rng, bool Streaming, bool Half> WalkerLoop find_walker_loop();
+	template <class Rng> WalkerLoop find_walker_loop();
+	WalkerLoop find_walker_loop();
+	uint64_t run_walker_simd(Walker &walker, uint64_t iterations, Recording recording);
+	template <class Rng> uint64_t run_view_loop(Walker &walker, uint64_t iterations, Recording recording);
+	uint64_t run_view(Walker &walker, uint64_t iterations, Recording recording);
+	uint64_t run_walker(Walker &walker, uint64_t iterations, Recording recording);
+	uint64_t run_walkers(uint64_t iterations, Recording recording);
+
+	void simulate(Walker &walker);
+	bool pause_walkers();
+	void resume_walkers();
+	void place_view(double center_x, double center_y, double zoom);
+
+	void sum_row(RowScratch &scratch, uint32_t out_width, uint32_t out_height, uint32_t row);
+	float density_peak(RowScratch &scratch, uint32_t out_width, uint32_t out_height);
+	void render_row(RowScratch &scratch, uint32_t *out, uint32_t *hits, uint32_t out_width, uint32_t out_height, uint32_t row, float peak);
+	void render_pixels(std::vector<uint32_t> &out, uint32_t out_width, uint32_t out_height, std::vector<uint32_t> *hits);
+	void image_row(RowScratch &scratch, const ImageExport &image, uint32_t y, uint32_t *frame, uint8_t *rgb);
+	bool encode_band(const ImageExport &image, uint32_t band, std::vector<uint8_t> &out, unsigned long &adler);
+	bool write_image(std::ostream &file, ImageFormat format);
+	bool write_image(const std::string &path, ImageFormat format);
+
+	uint64_t transient_iterations();
+	size_t arena_bytes();
+	void setup_game();
+
+	size_t grid_bytes();
+	void take_checkpoint(Checkpoint &checkpoint, uint64_t iterations);
+	bool restore_checkpoint(const Checkpoint &checkpoint);
+	void write_snapshot();
+	void save_checkpoint(const std::string &path, uint64_t iterations, bool wait);
+	bool same_game(const Checkpoint &checkpoint);
+	void merge_grid(const std::vector<uint8_t> &grid);
+	uint64_t count_cells();
+};
+
+/**
+* Packs an RGB colour into an ARGB8888 pixel.
+*/
+inline uint32_t argb(const uint8_t colour[3]){
+	return 0xFF000000 | uint32_t (colour[0]) << 16 | uint32_t (colour[1]) << 8 | colour[2];
+}
+
+/**
+* Blends the background colour towards the points colour.
+* @param level: 0 for the background, 1 for the points colour
+*/
+inline uint32_t blend_argb(float level){
+	uint8_t colour[3];
+	for (int c = 0; c < 3; c++){
+		colour[c] = CHAOS_BACKGROUND[c] + (CHAOS_POINTS[c] - CHAOS_BACKGROUND[c]) * level + 0.5f;
+	}
+	return argb(colour);
+}
+
+/**
+* Draws a uniform number in [0, range) with a multiply-shift range reduction.
+* Draws falling in the biased low region are rejected, which happens with probability range / 2^32.
+* @param threshold: (2^32 - range) % range, precomputed by the caller
+*/
+template <class Rng>
+inline uint32_t uniform_below(Rng &rng, uint32_t range, uint32_t threshold){
+	uint64_t product = uint64_t (rng.next_u32()) * range;
+	while (uint32_t (product) < threshold){
+		product = uint64_t (rng.next_u32()) * range;
+	}
+	return product >> 32;
+}
+
+/**
+* Draws a uniform number in [0, range) without a precomputed threshold.
+*/
+template <class Rng>
+inline uint32_t uniform_below(Rng &rng, uint32_t range){
+	return uniform_below(rng, range, (0u - range) % range);
+}
+
+/**
+* Chooses the walker's next vertex from the alias table of the previous one, without a branch:
+* the high half of random * n picks a column uniformly, and the low half is the coin that keeps it or takes its alias.
+*/
+inline uint32_t choose_vertex(uint32_t random, uint32_t n, uint32_t previous, const uint32_t *threshold, const uint32_t *other){
+	uint64_t product = uint64_t (random) * n;
+	uint32_t column = product >> 32, slot = previous * n + column;
+	return uint32_t (product) < threshold[slot] ? column : other[slot];
+}
+
+/**
+* Advances the xoshiro128+ stream of a SIMD lane, as the SIMD kernels do, and returns its output.
+*/
+inline uint32_t next_lane(uint32_t &s0, uint32_t &s1, uint32_t &s2, uint32_t &s3){
+	uint32_t result = s0 + s3;
+	uint32_t t = s1 << 9;
+	s2 ^= s0;
+	s3 ^= s1;
+	s1 ^= s2;
+	s0 ^= s3;
+	s2 ^= t;
+	s3 = (s3 << 11) | (s3 >> 21);
+	return result;
+}
+
+/**
+* Rolls the die of a SIMD lane from an output of its stream, as the SIMD kernels do: the high 32 bits of
+* output * range, redrawing from the lane's stream while the low 32 bits fall in the biased region, as
+* uniform_below does.
+* @param threshold: (2^32 - range) % range
+*/
+inline uint32_t lane_die(uint32_t result, uint32_t &s0, uint32_t &s1, uint32_t &s2, uint32_t &s3, uint32_t range, uint32_t threshold){
+	uint64_t product = uint64_t (result) * range;
+	while (uint32_t (product) < threshold){
+		product = uint64_t (next_lane(s0, s1, s2, s3)) * range;
+	}
+	return product >> 32;
+}
+
+/**
+* Returns the first of the cells, along one axis of size cells, that fall in a pixel of a downsampled image.
+* Cell c falls in pixel c * pixels / cells.
+* @param pixel: The pixel, pixels for the end of the last pixel
+* @param pixels: Size of the downsampled image along the axis
+*/
+inline uint32_t first_cell(uint32_t pixel, uint32_t pixels, uint32_t cells){
+	return (uint64_t (pixel) * cells + pixels - 1) / pixels;
+}
+
+// Functions of the engine that need no game, documented where chaos_engine.cpp defines them
+SimdKernel find_simd_kernel(KernelKind kind);
+KernelKind best_simd_kernel();
+KernelKind logical_kernel(KernelKind kind);
+bool parse_number(const std::string &text, double &value);
+bool read_ifs_file(const std::string &path, std::vector<AffineMap> &maps, std::vector<float> &weights, float frame[4]);
+uint64_t node_seed(uint64_t seed, uint32_t node);
+bool publish_points(Walker &walker);
+void take_points(Walker &walker, std::vector<Point> &points);
+void published_progress(std::vector<Walker> &walkers, uint64_t &iterations, uint64_t &points);
+uint64_t walker_iterations(const std::vector<Walker> &walkers);
+void encode_checkpoint(const Checkpoint &checkpoint, std::vector<uint8_t> &data);
+bool decode_checkpoint(Checkpoint &checkpoint, const std::vector<uint8_t> &data);
+
+}
+
+#endif
@@ -0,0 +1,162 @@
+// Options of the chaos program and the modes it runs without a window, shared between main.cpp, which parses the
+// options and runs the window, and modes.cpp, which runs the headless, bench, sweep, animation and distributed
+// modes. Both play their games through ChaosEngine alone, each game on an engine of its own.
+
+#ifndef CHAOS_PROGRAM_H
+#define CHAOS_PROGRAM_H
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <cstdint>
+
+#include "chaos_engine.h"
+
+// Parameters of the game, set by the options. Without --render-size the grid is the screen dimensions times
+// the supersampling factor, which render_size sets before every game.
+extern ChaosConfig config;
+extern bool flag_render_size_set;
+
+// Screen properties
+extern uint16_t screen_width;
+extern uint16_t screen_height;
+
+// Headless mode renders into memory and writes a single image, without SDL. Images are written as binary PPM,
+// the fastest, or PNG, the smallest, as given by --format or the extension of --output.
+extern bool flag_headless;
+extern bool flag_iterations_set;
+extern std::string output_path;
+extern bool flag_output_set;
+extern std::string image_format;
+extern bool flag_format_set;
+
+// Saturation stops a run, and writes its image, once fewer than saturation_rate new points per million
+// iterations are found over a window of whole stepping windows, long enough to expect SATURATION_POINTS
+// new points at that rate. Headless runs then only stop at the number of iterations if -n is given.
+extern bool flag_stop_saturated;
+extern double saturation_rate;
+
+// The window times the phases of its frames: taking the walkers' points, drawing them, presenting
+// the frame, bookkeeping such as checkpoints, handling events and waiting for the next frame.
+// With --stats a summary is written to stderr every stats_interval seconds, S toggles an overlay of it.
+enum FramePhase { PHASE_TAKE, PHASE_DRAW, PHASE_PRESENT, PHASE_OTHER, PHASE_EVENTS, PHASE_DELAY };
+const int NUM_PHASES = 6;
+extern double stats_interval;
+
+// Bench mode runs the iterations, without rendering, for every combination of the
+// comma-separated values given to --dimensions, --vertices, --fraction and --threads
+extern bool flag_bench;
+extern bool flag_bench_json;
+extern std::vector<std::pair<uint16_t, uint16_t>> bench_dimensions;
+extern std::vector<uint16_t> bench_vertices;
+extern std::vector<float> bench_factors;
+extern std::vector<uint16_t> bench_threads;
+
+// Sweep mode runs every combination of the swept vertex counts and fractions in turn, in headless mode,
+// writing each image as vN_fF.ppm, F being the fraction without its point, to the directory given by -o.
+// With sweep_jobs above 1, that many threads take the configurations from a shared queue and run them side by
+// side, each on its own engine reused between its configurations. Unless set, sweep_jobs is 0, for one job per
+// hardware thread, capped by the number of configurations.
+extern bool flag_sweep;
+extern std::vector<uint16_t> sweep_vertices;
+extern std::vector<float> sweep_factors;
+
+// Most values a sweep term may expand to
+const uint32_t MAX_SWEEP_VALUES = 65536;
+extern uint16_t sweep_jobs;
+
+// Animation mode renders animate_frames frames of a fraction going evenly from animate_first to animate_last,
+// each a headless run of -n iterations from the same seed on the reset engine. Frames are written in order,
+// as frame_NNNN images to the directory given by -o, or one after another to a file, a named pipe
+// or stdout ("-"), for an encoder to read as it goes
+extern bool flag_animate;
+extern float animate_first, animate_last;
+extern uint32_t animate_frames;
+
+// Checkpoints snapshot the grid, the parameters and the walkers every checkpoint_interval seconds,
+// and once more on exit. A run resumed from a checkpoint continues exactly where it left off:
+// resume_snapshot holds the checkpoint read by --resume, restored once the engine is created.
+extern bool flag_checkpoint;
+extern std::string checkpoint_path;
+extern double checkpoint_interval;
+extern bool flag_resume;
+extern std::string resume_path;
+extern std::vector<uint8_t> resume_snapshot;
+
+// Distributed mode: a coordinator started with --coordinator PORT waits for --nodes workers started with
+// --worker HOST:PORT, hands each its node number, the seed and the number of iterations, and merges the grids
+// they send back, in checkpoint format, before writing the image. Node k seeds its walkers from
+// ChaosEngine::node_seed(seed, k), the seed itself for node 0 and a SplitMix64 output of it for the others, so
+// no two nodes share a stream. Nodes must be given the same game parameters and share a byte order; the
+// coordinator ignores the grids of other games.
+extern std::string worker_address;
+extern uint16_t coordinator_port;
+extern uint16_t num_nodes;
+
+/**
+* Rate at which new unique points are still being found, in new points per million iterations over the
+* last window of iterations measured. It falls towards 0 as the image saturates.
+*/
+struct Convergence {
+	uint64_t iterations;
+	uint64_t points;
+	uint64_t window;
+	double rate;
+};
+
+/**
+* Statistics of the window over a span of frames: the time spent in each phase of the frames, and the
+* walkers' totals at the start of the span. Walkers count their iterations and points on their own and
+* hand them over with their points, so the window sums them at the frame boundary and the walkers
+* never share a counter.
+*/
+struct FrameStats {
+	uint64_t start, lap;
+	uint64_t frames;
+	uint64_t iterations, points;
+	uint64_t phase_ticks[NUM_PHASES];
+};
+
+/**
+* Returns the time in ticks of a monotonic clock, nanoseconds.
+*/
+inline uint64_t stats_ticks(){
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+* Adds the time since the last lap to a phase of the frames.
+*/
+inline void lap_phase(FrameStats &stats, FramePhase phase){
+	uint64_t now = stats_ticks();
+	stats.phase_ticks[phase] += now - stats.lap;
+	stats.lap = now;
+}
+
+// Parsers of option arguments, documented where modes.cpp defines them, which the tests link
+std::vector<std::string> split_list(const std::string &arg);
+bool parse_weights(const std::string &arg, std::vector<float> &weights);
+bool parse_sweep_term(const std::string &term, std::vector<uint16_t> &vertices, std::vector<float> &factors);
+
+// Functions of the modes, documented where modes.cpp defines them
+void render_size();
+void signal_interrupt(int _);
+uint64_t saturation_window();
+void measure_convergence(Convergence &convergence, uint64_t iterations, uint64_t points);
+bool check_saturation(Convergence &saturation, uint64_t iterations, uint64_t points);
+void reset_stats(FrameStats &stats, uint64_t iterations, uint64_t points);
+double stats_seconds(const FrameStats &stats);
+std::vector<std::string> stats_lines(const FrameStats &stats, uint64_t iterations, uint64_t points);
+double stats_span();
+void log_stats(const std::vector<std::string> &lines);
+bool read_snapshot(const std::string &path, std::vector<uint8_t> &snapshot);
+int run_headless(ChaosEngine &engine, const ChaosConfig &game, const std::string &path, std::ostream *frame_stream, std::ostream &log);
+int run_worker();
+int run_coordinator();
+int run_bench();
+int run_sweep();
+int run_animation(std::streambuf *stdout_buffer);
+
+#endif
@@ -1,20 +1,54 @@
 #include <SDL2/SDL.h>
-
+#include <SDL2/SDL_opengl.h>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <signal.h>
-#include <unordered_map>
 #include <unistd.h>
 #include <getopt.h>
-#include <typeinfo>
 #include <sstream>
+#include <fstream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+
+#include "chaos_engine.h"
+#include "chaos_program.h"
+
+// Renderer backends: points drawn as rects onto a target texture, or written into a
+// CPU-side ARGB8888 pixel buffer that is uploaded to a streaming texture once per frame
+enum RendererKind { RENDERER_TARGET, RENDERER_STREAMING };
+const char *RENDERER_NAMES[] = {"target", "streaming"};
+RendererKind renderer_kind = RENDERER_STREAMING;
+
+// Backends: the cpu runs the walkers on threads, the gpu runs them in OpenGL compute shaders that accumulate
+// the density and draw the window without a round trip through the CPU
+enum BackendKind { BACKEND_CPU, BACKEND_GPU };
+const char *BACKEND_NAMES[] = {"cpu", "gpu"};
+BackendKind backend_kind = BACKEND_CPU;
 
-#ifndef M_PI
-#define M_PI 3.14159265
-#endif
+// The window is refreshed fps times per second (0 for as often as possible), and shows the statistics
+// in an overlay with --overlay, which S toggles
+uint16_t fps = 20;
+bool flag_overlay = false;
 
-typedef struct { uint16_t x; uint16_t y; } Vertex;
+// Colour of the overlay's text, the others are those of the engine
+const uint8_t COLOUR_OVERLAY[3] = {0xFF, 0xFF, 0xFF};
+
+// Drawn rectangle properties
+const uint16_t RECTS_WIDTH = 1;
+const uint16_t RECTS_HEIGHT = 1;
+
+// Zoom and pan: the engine keeps a view of the window's size, which it fills at screen resolution while
+// zoomed in. The wheel and + and - zoom by ZOOM_STEP, the arrow keys pan by PAN_STEP pixels.
+const double ZOOM_STEP = 1.25;
+const int PAN_STEP = 32;
 
 const option long_opts[] = {
 	{"vertices", 1, 0, 'v'},
@@ -22,147 +56,1616 @@ const option long_opts[] = {
 	{"stepping", 1, 0, 's'},
 	{"frame-delay", 1, 0, 'd'},
 	{"dimensions", 1, 0, 'z'},
+	{"headless", 0, 0, 'H'},
+	{"iterations", 1, 0, 'n'},
+	{"output", 1, 0, 'o'},
+	{"format", 1, 0, 'e'},
+	{"threads", 1, 0, 't'},
+	{"rng", 1, 0, 'r'},
+	{"seed", 1, 0, 'S'},
+	{"renderer", 1, 0, 'R'},
+	{"fps", 1, 0, 'F'},
+	{"kernel", 1, 0, 'k'},
+	{"bench", 0, 0, 'B'},
+	{"bench-format", 1, 0, 'J'},
+	{"density", 0, 0, 'D'},
+	{"tone", 1, 0, 'T'},
+	{"gamma", 1, 0, 'G'},
+	{"render-size", 1, 0, 'Z'},
+	{"supersample", 1, 0, 'A'},
+	{"tile-file", 1, 0, 'L'},
+	{"tile-memory", 1, 0, 'M'},
+	{"checkpoint", 1, 0, 'C'},
+	{"checkpoint-interval", 1, 0, 'I'},
+	{"resume", 1, 0, 'U'},
+	{"stream", 1, 0, 'P'},
+	{"stream-format", 1, 0, 'E'},
+	{"stream-points", 1, 0, 'W'},
+	{"burn-in", 1, 0, 'b'},
+	{"stop-when-saturated", 0, 0, 'X'},
+	{"saturation-rate", 1, 0, 'Y'},
+	{"backend", 1, 0, 'g'},
+	{"stats", 1, 0, 'K'},
+	{"overlay", 0, 0, 'O'},
+	{"weights", 1, 0, 'w'},
+	{"restrict", 1, 0, 'x'},
+	{"ifs", 1, 0, 'i'},
+	{"sweep", 1, 0, 'p'},
+	{"jobs", 1, 0, 'q'},
+	{"animate", 1, 0, 'a'},
+	{"frames", 1, 0, 'u'},
+	{"worker", 1, 0, 'j'},
+	{"coordinator", 1, 0, 'c'},
+	{"nodes", 1, 0, 'N'},
 	{"help", 0, 0, 'h'},
 	{0,0,0,0}
 };
 
-// Screen properties
-uint16_t screen_width = 1000;
-uint16_t screen_height = 1000;
-const float SCREEN_MARGINS = 0.05;
+/**
+* Log an SDL error with some error message
+* @param msg: The error message to write, format will be msg error: SDL_GetError()
+*/
+void log_SDL_error(const std::string &msg){
+	std::cerr << msg << " error: " << SDL_GetError() << std::endl;
+}
 
-// Parameters of the Chaos Game
-uint16_t num_vertices = 3;
-float factor = 0.5;
+// Glyphs of the overlay font, 5x7 pixels for the characters from space to Z, one row per byte with
+// the leftmost pixel in bit 4. Lowercase text is drawn in uppercase, characters without a glyph blank.
+const uint8_t FONT_GLYPHS[][7] = {
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // space
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // !
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // "
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // #
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // $
+	{0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}, // %
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // &
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // '
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // (
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // )
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // *
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // +
+	{0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08}, // ,
+	{0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}, // -
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}, // .
+	{0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}, // /
+	{0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}, // 0
+	{0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}, // 1
+	{0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}, // 2
+	{0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}, // 3
+	{0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}, // 4
+	{0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}, // 5
+	{0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}, // 6
+	{0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, // 7
+	{0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}, // 8
+	{0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}, // 9
+	{0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}, // :
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // ;
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // <
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // =
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // >
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // ?
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // @
+	{0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, // A
+	{0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}, // B
+	{0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}, // C
+	{0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}, // D
+	{0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}, // E
+	{0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}, // F
+	{0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}, // G
+	{0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, // H
+	{0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}, // I
+	{0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}, // J
+	{0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}, // K
+	{0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}, // L
+	{0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}, // M
+	{0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}, // N
+	{0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // O
+	{0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}, // P
+	{0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}, // Q
+	{0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}, // R
+	{0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}, // S
+	{0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, // T
+	{0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // U
+	{0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}, // V
+	{0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}, // W
+	{0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}, // X
+	{0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}, // Y
+	{0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}, // Z
+};
+const char FONT_FIRST = ' ', FONT_LAST = 'Z';
+const int FONT_WIDTH = 5, FONT_HEIGHT = 7;
+const int OVERLAY_SCALE = 2, OVERLAY_MARGIN = 8;
 
-// Drawn colours
-uint8_t colour_background[3] = {0x00, 0x00, 0x00};
-uint8_t colour_vertices[3] = {0xFF, 0x10, 0x10};
-uint8_t colour_points[3] = {0x30, 0x90, 0x80};
+/**
+* Lays out lines of text in the overlay font, scaled by OVERLAY_SCALE, in the top left corner of the window.
+* @param rects: Receives a rect for every lit pixel of the glyphs
+* @return The rect behind the text.
+*/
+SDL_Rect overlay_rects(const std::vector<std::string> &lines, std::vector<SDL_Rect> &rects){
+	const int advance = (FONT_WIDTH + 1) * OVERLAY_SCALE, line_height = (FONT_HEIGHT + 2) * OVERLAY_SCALE;
+	size_t longest = 0;
+	rects.clear();
+	for (size_t l = 0; l < lines.size(); l++){
+		longest = std::max(longest, lines[l].size());
+		for (size_t c = 0; c < lines[l].size(); c++){
+			char ch = std::toupper(lines[l][c]);
+			if (ch < FONT_FIRST || ch > FONT_LAST){
+				continue;
+			}
+			const uint8_t *glyph = FONT_GLYPHS[ch - FONT_FIRST];
+			for (int y = 0; y < FONT_HEIGHT; y++){
+				for (int x = 0; x < FONT_WIDTH; x++){
+					if (glyph[y] & (0x10 >> x)){
+						rects.push_back(SDL_Rect {int (OVERLAY_MARGIN + c * advance + x * OVERLAY_SCALE),
+							int (OVERLAY_MARGIN + l * line_height + y * OVERLAY_SCALE), OVERLAY_SCALE, OVERLAY_SCALE});
+					}
+				}
+			}
+		}
+	}
+	return SDL_Rect {OVERLAY_MARGIN / 2, OVERLAY_MARGIN / 2, int (longest * advance + OVERLAY_MARGIN), int (lines.size() * line_height + OVERLAY_MARGIN)};
+}
 
-// Drawn rectangle properties
-const uint16_t RECTS_WIDTH = 1;
-const uint16_t RECTS_HEIGHT = 1;
+// The streaming renderer's pixel buffer, and the number of marked cells in each of its pixels, which it blends by
+std::vector<uint32_t> pixels;
+std::vector<uint32_t> view_hits;
 
-// Primes used in hashing function
-const double PRIME_1 = 20011;
-const double PRIME_2 = 24481;
+// The view of the engine, as it was last set: zoomed in, or the whole grid
+bool flag_zoomed = false;
+double view_center_x = 0, view_center_y = 0, view_zoom = 1;
 
-// Rate of progress
-uint64_t stepping = 2500;
-uint16_t frame_delay_ms = 50;
+/**
+* Returns the index of the window pixel that the cell (x, y) of the grid falls in, while the view is the whole grid.
+*/
+inline uint32_t view_index(const ChaosEngine &engine, uint32_t x, uint32_t y){
+	return uint64_t (y) * screen_height / engine.height() * screen_width + uint64_t (x) * screen_width / engine.width();
+}
 
-// flag_continue dictates the continuation of the game
-bool flag_continue = true;
+/**
+* Returns the number of cells of the grid that fall in a window pixel, while the view is the whole grid.
+*/
+inline uint32_t view_cells(const ChaosEngine &engine, uint32_t index){
+	uint32_t x = index % screen_width, y = index / screen_width;
+	return (ChaosEngine::first_cell(x + 1, screen_width, engine.width()) - ChaosEngine::first_cell(x, screen_width, engine.width()))
+		* (ChaosEngine::first_cell(y + 1, screen_height, engine.height()) - ChaosEngine::first_cell(y, screen_height, engine.height()));
+}
 
 /**
-* Log an SDL error with some error message
-* @param msg: The error message to write, format will be msg error: SDL_GetError()
+* Clears the window's canvas for a new view, and redraws the grid when the view is the whole grid again:
+* the streaming renderer from the framebuffer of the engine and its hits, the target renderer as a rect for every
+* pixel with a hit, which it only uses when the grid matches the screen.
 */
-void log_SDL_error(const std::string &msg){
-	std::cerr << msg << " error: " << SDL_GetError() << std::endl;
+void clear_canvas(const ChaosEngine &engine, SDL_Renderer *renderer, SDL_Texture *canvas, std::vector<SDL_Rect> &rects){
+	if (renderer_kind == RENDERER_TARGET){
+		SDL_SetRenderTarget(renderer, canvas);
+		SDL_SetRenderDrawColor(renderer, CHAOS_BACKGROUND[0], CHAOS_BACKGROUND[1], CHAOS_BACKGROUND[2], 0xFF);
+		SDL_RenderClear(renderer);
+		SDL_SetRenderTarget(renderer, nullptr);
+		rects.clear();
+		if (!flag_zoomed){
+			engine.framebuffer(pixels, screen_width, screen_height, &view_hits);
+			for (uint32_t index = 0; index < view_hits.size(); index++){
+				if (view_hits[index] > 0){
+					rects.push_back(SDL_Rect {int (index % screen_width), int (index / screen_width), RECTS_WIDTH, RECTS_HEIGHT});
+				}
+			}
+		}
+	}
+	else if (flag_zoomed){
+		std::fill(pixels.begin(), pixels.end(), ChaosEngine::argb(CHAOS_BACKGROUND));
+		std::fill(view_hits.begin(), view_hits.end(), 0);
+	}
+	else{
+		engine.framebuffer(pixels, screen_width, screen_height, &view_hits);
+	}
+}
+
+/**
+* OpenGL functions used by the GPU backend, loaded through SDL_GL_GetProcAddress so the program does not
+* link against libGL. Functions of OpenGL 1.1 have no pointer types in glext.h, so they get their own.
+*/
+typedef void (APIENTRYP GpuClearProc)(GLbitfield mask);
+typedef void (APIENTRYP GpuClearColorProc)(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+typedef void (APIENTRYP GpuScissorProc)(GLint x, GLint y, GLsizei width, GLsizei height);
+typedef void (APIENTRYP GpuCapabilityProc)(GLenum cap);
+typedef void (APIENTRYP GpuGenTexturesProc)(GLsizei n, GLuint *textures);
+typedef void (APIENTRYP GpuBindTextureProc)(GLenum target, GLuint texture);
+typedef void (APIENTRYP GpuDeleteTexturesProc)(GLsizei n, const GLuint *textures);
+typedef GLenum (APIENTRYP GpuGetErrorProc)(void);
+
+#define GPU_GL_FUNCTIONS(F) \
+	F(GpuClearProc, Clear) \
+	F(GpuClearColorProc, ClearColor) \
+	F(GpuScissorProc, Scissor) \
+	F(GpuCapabilityProc, Enable) \
+	F(GpuCapabilityProc, Disable) \
+	F(GpuGenTexturesProc, GenTextures) \
+	F(GpuBindTextureProc, BindTexture) \
+	F(GpuDeleteTexturesProc, DeleteTextures) \
+	F(GpuGetErrorProc, GetError) \
+	F(PFNGLTEXSTORAGE2DPROC, TexStorage2D) \
+	F(PFNGLBINDIMAGETEXTUREPROC, BindImageTexture) \
+	F(PFNGLCREATESHADERPROC, CreateShader) \
+	F(PFNGLSHADERSOURCEPROC, ShaderSource) \
+	F(PFNGLCOMPILESHADERPROC, CompileShader) \
+	F(PFNGLGETSHADERIVPROC, GetShaderiv) \
+	F(PFNGLGETSHADERINFOLOGPROC, GetShaderInfoLog) \
+	F(PFNGLDELETESHADERPROC, DeleteShader) \
+	F(PFNGLCREATEPROGRAMPROC, CreateProgram) \
+	F(PFNGLATTACHSHADERPROC, AttachShader) \
+	F(PFNGLLINKPROGRAMPROC, LinkProgram) \
+	F(PFNGLGETPROGRAMIVPROC, GetProgramiv) \
+	F(PFNGLGETPROGRAMINFOLOGPROC, GetProgramInfoLog) \
+	F(PFNGLDELETEPROGRAMPROC, DeleteProgram) \
+	F(PFNGLUSEPROGRAMPROC, UseProgram) \
+	F(PFNGLGETUNIFORMLOCATIONPROC, GetUniformLocation) \
+	F(PFNGLUNIFORM1UIPROC, Uniform1ui) \
+	F(PFNGLUNIFORM2UIPROC, Uniform2ui) \
+	F(PFNGLUNIFORM1FPROC, Uniform1f) \
+	F(PFNGLUNIFORM3FPROC, Uniform3f) \
+	F(PFNGLGENBUFFERSPROC, GenBuffers) \
+	F(PFNGLBINDBUFFERPROC, BindBuffer) \
+	F(PFNGLBUFFERDATAPROC, BufferData) \
+	F(PFNGLBUFFERSUBDATAPROC, BufferSubData) \
+	F(PFNGLGETBUFFERSUBDATAPROC, GetBufferSubData) \
+	F(PFNGLBINDBUFFERBASEPROC, BindBufferBase) \
+	F(PFNGLDELETEBUFFERSPROC, DeleteBuffers) \
+	F(PFNGLDISPATCHCOMPUTEPROC, DispatchCompute) \
+	F(PFNGLMEMORYBARRIERPROC, MemoryBarrier) \
+	F(PFNGLGENFRAMEBUFFERSPROC, GenFramebuffers) \
+	F(PFNGLBINDFRAMEBUFFERPROC, BindFramebuffer) \
+	F(PFNGLFRAMEBUFFERTEXTURE2DPROC, FramebufferTexture2D) \
+	F(PFNGLBLITFRAMEBUFFERPROC, BlitFramebuffer) \
+	F(PFNGLDELETEFRAMEBUFFERSPROC, DeleteFramebuffers)
+
+struct GpuApi {
+#define GPU_GL_MEMBER(type, name) type name;
+	GPU_GL_FUNCTIONS(GPU_GL_MEMBER)
+#undef GPU_GL_MEMBER
+};
+
+/**
+* Loads every function of GpuApi from the current context.
+* @return false if one is missing.
+*/
+bool load_gpu_api(GpuApi &gl){
+	bool loaded = true;
+#define GPU_GL_LOAD(type, name) \
+	gl.name = reinterpret_cast<type>(SDL_GL_GetProcAddress("gl" #name)); \
+	loaded = loaded && gl.name != nullptr;
+	GPU_GL_FUNCTIONS(GPU_GL_LOAD)
+#undef GPU_GL_LOAD
+	return loaded;
+}
+
+// Walkers run by the GPU backend, one per invocation in groups of GPU_GROUP, each with a point and a
+// xoshiro128+ state. Every frame each walker runs stepping iterations, adding its hits to a density buffer
+// of 32-bit counters with atomic adds, which also count the new points.
+const uint32_t GPU_WALKERS = 1 << 16;
+const uint32_t GPU_GROUP = 64;
+
+// Buffer bindings shared by the shaders
+enum GpuBinding { GPU_POINTS, GPU_STATES, GPU_VERTICES, GPU_DENSITY, GPU_COUNTERS, GPU_FIRST_X, GPU_FIRST_Y, GPU_MEANS };
+
+// Counters: new points found, and the peak mean count of the current frame's pixels, as float bits
+const char *GPU_STEP_SHADER = R"(#version 430
+layout(local_size_x = 64) in;
+layout(std430, binding = 0) buffer Points { vec2 points[]; };
+layout(std430, binding = 1) buffer States { uvec4 states[]; };
+layout(std430, binding = 2) readonly buffer Vertices { vec2 vertices[]; };
+layout(std430, binding = 3) buffer Density { uint density[]; };
+layout(std430, binding = 4) buffer Counters { uint new_points; uint peak; };
+uniform uint num_vertices;
+uniform uint die_threshold;
+uniform float factor;
+uniform uint skip;
+uniform uint steps;
+uniform uvec2 size;
+
+// Advances a xoshiro128+ state and returns its output
+uint next(inout uvec4 s){
+	uint result = s.x + s.w;
+	uint t = s.y << 9;
+	s.z ^= s.x;
+	s.w ^= s.y;
+	s.y ^= s.z;
+	s.x ^= s.w;
+	s.z ^= t;
+	s.w = (s.w << 11) | (s.w >> 21);
+	return result;
+}
+
+void main(){
+	uint walker = gl_GlobalInvocationID.x;
+	vec2 point = points[walker];
+	uvec4 s = states[walker];
+	uint found = 0u;
+	for (uint i = 0u; i < skip + steps; i++){
+		// Roll the die with a multiply-shift, redrawing while the low half falls below die_threshold, as the CPU does
+		uint vertex, low;
+		umulExtended(next(s), num_vertices, vertex, low);
+		while (low < die_threshold){
+			umulExtended(next(s), num_vertices, vertex, low);
+		}
+		point = mix(point, vertices[vertex], factor);
+		if (i >= skip){
+			uvec2 cell = min(uvec2(point), size - 1u);
+			uint index = cell.y * size.x + cell.x;
+			uint old = atomicAdd(density[index], 1u);
+			if (old == 0u){
+				found++;
+			}
+			else if (old == 0xFFFFFFFFu){
+				atomicMax(density[index], 0xFFFFFFFFu);
+			}
+		}
+	}
+	points[walker] = point;
+	states[walker] = s;
+	if (found > 0u){
+		atomicAdd(new_points, found);
+	}
+}
+)";
+
+// Averages the counts over the cells of every window pixel, as sum_row, and finds their peak
+const char *GPU_RESOLVE_SHADER = R"(#version 430
+layout(local_size_x = 8, local_size_y = 8) in;
+layout(std430, binding = 3) readonly buffer Density { uint density[]; };
+layout(std430, binding = 4) buffer Counters { uint new_points; uint peak; };
+layout(std430, binding = 5) readonly buffer FirstX { uint first_x[]; };
+layout(std430, binding = 6) readonly buffer FirstY { uint first_y[]; };
+layout(std430, binding = 7) writeonly buffer Means { float means[]; };
+uniform uvec2 size;
+uniform uvec2 screen;
+uniform uint density_mode;
+
+void main(){
+	uvec2 pixel = gl_GlobalInvocationID.xy;
+	if (pixel.x >= screen.x || pixel.y >= screen.y){
+		return;
+	}
+	float sum = 0.0;
+	for (uint y = first_y[pixel.y]; y < first_y[pixel.y + 1u]; y++){
+		for (uint x = first_x[pixel.x]; x < first_x[pixel.x + 1u]; x++){
+			uint count = density[y * size.x + x];
+			sum += density_mode != 0u ? float(count) : float(min(count, 1u));
+		}
+	}
+	float cells = float((first_x[pixel.x + 1u] - first_x[pixel.x]) * (first_y[pixel.y + 1u] - first_y[pixel.y]));
+	float mean = cells > 0.0 ? sum / cells : 0.0;
+	means[pixel.y * screen.x + pixel.x] = mean;
+	if (density_mode != 0u && mean > 0.0){
+		atomicMax(peak, floatBitsToUint(mean));
+	}
+}
+)";
+
+// Tone maps the means into the image, as render_row, with rows flipped for the bottom-up framebuffer
+const char *GPU_TONE_SHADER = R"(#version 430
+layout(local_size_x = 8, local_size_y = 8) in;
+layout(std430, binding = 4) readonly buffer Counters { uint new_points; uint peak; };
+layout(std430, binding = 7) readonly buffer Means { float means[]; };
+layout(rgba8, binding = 0) writeonly uniform image2D image;
+uniform uvec2 screen;
+uniform uint density_mode;
+uniform uint tone;
+uniform float gamma;
+uniform vec3 background;
+uniform vec3 foreground;
+
+void main(){
+	uvec2 pixel = gl_GlobalInvocationID.xy;
+	if (pixel.x >= screen.x || pixel.y >= screen.y){
+		return;
+	}
+	float mean = means[pixel.y * screen.x + pixel.x];
+	float peak_mean = uintBitsToFloat(peak);
+	float level = 0.0;
+	if (mean > 0.0){
+		if (density_mode == 0u){
+			level = mean;
+		}
+		else if (tone == 0u){
+			level = log(1.0 + mean) / log(1.0 + peak_mean);
+		}
+		else{
+			level = pow(mean / peak_mean, 1.0 / gamma);
+		}
+	}
+	imageStore(image, ivec2(pixel.x, screen.y - 1u - pixel.y), vec4(mix(background, foreground, level) / 255.0, 1.0));
+}
+)";
+
+/**
+* Compiles and links a compute shader.
+* @return The program, or 0 if it failed to build, in which case the log is written to stderr.
+*/
+GLuint build_gpu_program(GpuApi &gl, const char *source){
+	GLuint shader = gl.CreateShader(GL_COMPUTE_SHADER);
+	gl.ShaderSource(shader, 1, &source, nullptr);
+	gl.CompileShader(shader);
+	GLint status = 0;
+	char log[1024] = "";
+	gl.GetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (!status){
+		gl.GetShaderInfoLog(shader, sizeof(log), nullptr, log);
+		std::cerr << "Compute shader error: " << log << std::endl;
+		gl.DeleteShader(shader);
+		return 0;
+	}
+	GLuint program = gl.CreateProgram();
+	gl.AttachShader(program, shader);
+	gl.LinkProgram(program);
+	gl.DeleteShader(shader);
+	gl.GetProgramiv(program, GL_LINK_STATUS, &status);
+	if (!status){
+		gl.GetProgramInfoLog(program, sizeof(log), nullptr, log);
+		std::cerr << "Compute program error: " << log << std::endl;
+		gl.DeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+/**
+* Creates a shader storage buffer bound to binding, filled with size bytes of data, or zeros if data is nullptr.
+*/
+GLuint create_gpu_buffer(GpuApi &gl, GpuBinding binding, size_t size, const void *data){
+	GLuint buffer;
+	gl.GenBuffers(1, &buffer);
+	gl.BindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+	if (data == nullptr){
+		std::vector<uint8_t> zeros(size, 0);
+		gl.BufferData(GL_SHADER_STORAGE_BUFFER, size, zeros.data(), GL_DYNAMIC_COPY);
+	}
+	else{
+		gl.BufferData(GL_SHADER_STORAGE_BUFFER, size, data, GL_DYNAMIC_COPY);
+	}
+	gl.BindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+	return buffer;
+}
+
+/**
+* Returns the cells that start every pixel along one axis of the window, and the end of the last one.
+*/
+std::vector<uint32_t> first_cells(uint32_t pixels, uint32_t cells){
+	std::vector<uint32_t> first(pixels + 1);
+	for (uint32_t p = 0; p <= pixels; p++){
+		first[p] = ChaosEngine::first_cell(p, pixels, cells);
+	}
+	return first;
+}
+
+/**
+* Loads the density counts of the GPU into the grid of the engine, so that it can write the image.
+* @return false if the engine could not load them.
+*/
+bool read_gpu_density(GpuApi &gl, GLuint buffer, ChaosEngine &engine){
+	std::vector<uint32_t> counts(uint64_t (engine.width()) * engine.height());
+	gl.BindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+	gl.GetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, counts.size() * sizeof(uint32_t), counts.data());
+	return engine.load_hits(counts);
+}
+
+/**
+* Returns whether an event asks to quit: the window's exit button, Escape or Q.
+*/
+bool is_quit_event(const SDL_Event &event){
+	return event.type == SDL_QUIT
+		|| (event.type == SDL_KEYDOWN && (event.key.keysym.sym == SDLK_ESCAPE || event.key.keysym.sym == SDLK_q));
+}
+
+/**
+* Sets the view of the engine, and takes over the view it settled on, clamped to the grid and the largest zoom.
+*/
+void set_view(ChaosEngine &engine, double center_x, double center_y, double zoom){
+	engine.set_view(center_x, center_y, zoom);
+	engine.view(view_center_x, view_center_y, view_zoom);
+	flag_zoomed = view_zoom > 1.0;
+}
+
+/**
+* Zooms the view by a factor around the window pixel (x, y), which stays over the same point of the grid.
+*/
+void zoom_view(ChaosEngine &engine, int x, int y, double factor){
+	double base = std::min(double (screen_width) / engine.width(), double (screen_height) / engine.height());
+	double zoom = std::min(std::max(view_zoom * factor, 1.0), ChaosEngine::MAX_ZOOM);
+	double offset_x = x - screen_width / 2.0, offset_y = y - screen_height / 2.0;
+	double cell_x = view_center_x + offset_x / (base * view_zoom), cell_y = view_center_y + offset_y / (base * view_zoom);
+	set_view(engine, cell_x - offset_x / (base * zoom), cell_y - offset_y / (base * zoom), zoom);
+}
+
+/**
+* Moves the zoomed view by a number of window pixels.
+*/
+void pan_view(ChaosEngine &engine, int x, int y){
+	double scale = std::min(double (screen_width) / engine.width(), double (screen_height) / engine.height()) * view_zoom;
+	set_view(engine, view_center_x + x / scale, view_center_y + y / scale, view_zoom);
 }
 
 /**
-* Handles interrupts, sets a flag to discontinue computation.
+* Handles the events that zoom and pan the view: the mouse wheel zooms around the pointer, + and - around the
+* centre, dragging with the left button or the arrow keys pan, and 0 or Home return to the whole grid.
+* Density mode always shows the whole grid.
+* @return true if the view changed.
 */
-void signal_interrupt(int _){
+bool view_event(const SDL_Event &event, ChaosEngine &engine){
+	if (config.density){
+		return false;
+	}
+	if (event.type == SDL_MOUSEWHEEL && event.wheel.y != 0){
+		int x, y;
+		SDL_GetMouseState(&x, &y);
+		zoom_view(engine, x, y, std::pow(ZOOM_STEP, event.wheel.y));
+		return true;
+	}
+	if (event.type == SDL_MOUSEMOTION && (event.motion.state & SDL_BUTTON_LMASK) && flag_zoomed){
+		pan_view(engine, -event.motion.xrel, -event.motion.yrel);
+		return true;
+	}
+	if (event.type != SDL_KEYDOWN){
+		return false;
+	}
+	switch (event.key.keysym.sym){
+		case SDLK_PLUS:
+		case SDLK_EQUALS:
+			zoom_view(engine, screen_width / 2, screen_height / 2, ZOOM_STEP);
+			return true;
+		case SDLK_MINUS:
+			zoom_view(engine, screen_width / 2, screen_height / 2, 1.0 / ZOOM_STEP);
+			return true;
+		case SDLK_0:
+		case SDLK_HOME:
+			set_view(engine, 0, 0, 1);
+			return true;
+	}
+	if (!flag_zoomed){
+		return false;
+	}
+	switch (event.key.keysym.sym){
+		case SDLK_LEFT:
+			pan_view(engine, -PAN_STEP, 0);
+			return true;
+		case SDLK_RIGHT:
+			pan_view(engine, PAN_STEP, 0);
+			return true;
+		case SDLK_UP:
+			pan_view(engine, 0, -PAN_STEP);
+			return true;
+		case SDLK_DOWN:
+			pan_view(engine, 0, PAN_STEP);
+			return true;
+	}
+	return false;
+}
+
+// Returned by run_gpu when the GPU backend cannot run
+const int GPU_UNAVAILABLE = -1;
+
+/**
+* Plays the game in the window on the GPU: GPU_WALKERS walkers in a compute shader accumulate the density
+* on the device, which two more compute shaders resolve to the window size and tone map into a texture that is
+* blitted to the window. Only the new points counter comes back to the CPU, for the convergence measure.
+* The engine places the walkers, and holds the game only to write its image, which it takes from the GPU.
+* @return The exit status of the program, or GPU_UNAVAILABLE if there is no OpenGL 4.3 context to run on,
+* in which case SDL is shut down again.
+*/
+int run_gpu(ChaosEngine &engine){
+	if (SDL_Init(SDL_INIT_VIDEO) != 0){
+		log_SDL_error("SDL_Init");
+		return 1;
+	}
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+	SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+	SDL_Window *window = SDL_CreateWindow("Chaos Game",
+		SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+		screen_width, screen_height,
+		SDL_WINDOW_OPENGL);
+	if (window == nullptr){
+		log_SDL_error("CreateWindow");
+		SDL_Quit();
+		return GPU_UNAVAILABLE;
+	}
+	SDL_GLContext context = SDL_GL_CreateContext(window);
+	GpuApi gl;
+	if (context == nullptr || !load_gpu_api(gl)){
+		log_SDL_error("GL_CreateContext");
+		if (context != nullptr){
+			SDL_GL_DeleteContext(context);
+		}
+		SDL_DestroyWindow(window);
+		SDL_Quit();
+		return GPU_UNAVAILABLE;
+	}
+	SDL_GL_SetSwapInterval(0);
+
+	GLuint step_program = build_gpu_program(gl, GPU_STEP_SHADER);
+	GLuint resolve_program = build_gpu_program(gl, GPU_RESOLVE_SHADER);
+	GLuint tone_program = build_gpu_program(gl, GPU_TONE_SHADER);
+
+	// Place the walkers as the CPU lanes are placed, from one stream of the seed
+	std::vector<float> walker_points;
+	std::vector<uint32_t> walker_states;
+	engine.place_lanes(GPU_WALKERS, walker_points, walker_states);
+	std::vector<ChaosVertex> vertices = engine.vertices();
+	uint32_t num_vertices = vertices.size(), render_width = engine.width(), render_height = engine.height();
+	std::vector<float> vertex_points(2 * num_vertices);
+	for (uint32_t v = 0; v < num_vertices; v++){
+		vertex_points[2 * v] = vertices[v].x;
+		vertex_points[2 * v + 1] = vertices[v].y;
+	}
+	std::vector<uint32_t> first_x = first_cells(screen_width, render_width), first_y = first_cells(screen_height, render_height);
+	const uint32_t counters_zero[2] = {0, 0};
+
+	GLuint buffers[] = {
+		create_gpu_buffer(gl, GPU_POINTS, walker_points.size() * sizeof(float), walker_points.data()),
+		create_gpu_buffer(gl, GPU_STATES, walker_states.size() * sizeof(uint32_t), walker_states.data()),
+		create_gpu_buffer(gl, GPU_VERTICES, vertex_points.size() * sizeof(float), vertex_points.data()),
+		create_gpu_buffer(gl, GPU_DENSITY, uint64_t (render_width) * render_height * sizeof(uint32_t), nullptr),
+		create_gpu_buffer(gl, GPU_COUNTERS, sizeof(counters_zero), counters_zero),
+		create_gpu_buffer(gl, GPU_FIRST_X, first_x.size() * sizeof(uint32_t), first_x.data()),
+		create_gpu_buffer(gl, GPU_FIRST_Y, first_y.size() * sizeof(uint32_t), first_y.data()),
+		create_gpu_buffer(gl, GPU_MEANS, uint64_t (screen_width) * screen_height * sizeof(float), nullptr)
+	};
+	const int num_buffers = sizeof(buffers) / sizeof(buffers[0]);
+
+	// The image the tone shader writes, read by the blit through a framebuffer
+	GLuint image, framebuffer;
+	gl.GenTextures(1, &image);
+	gl.BindTexture(GL_TEXTURE_2D, image);
+	gl.TexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, screen_width, screen_height);
+	gl.BindImageTexture(0, image, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+	gl.GenFramebuffers(1, &framebuffer);
+	gl.BindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	gl.FramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, image, 0);
+
+	GLenum error = gl.GetError();
+	if (step_program == 0 || resolve_program == 0 || tone_program == 0 || error != GL_NO_ERROR){
+		if (error != GL_NO_ERROR){
+			std::cerr << "OpenGL error " << error << " while creating the GPU buffers." << std::endl;
+		}
+		gl.DeleteFramebuffers(1, &framebuffer);
+		gl.DeleteTextures(1, &image);
+		gl.DeleteBuffers(num_buffers, buffers);
+		gl.DeleteProgram(step_program);
+		gl.DeleteProgram(resolve_program);
+		gl.DeleteProgram(tone_program);
+		SDL_GL_DeleteContext(context);
+		SDL_DestroyWindow(window);
+		SDL_Quit();
+		return GPU_UNAVAILABLE;
+	}
+
+	gl.UseProgram(step_program);
+	gl.Uniform1ui(gl.GetUniformLocation(step_program, "num_vertices"), num_vertices);
+	gl.Uniform1ui(gl.GetUniformLocation(step_program, "die_threshold"), (0u - num_vertices) % num_vertices);
+	gl.Uniform1f(gl.GetUniformLocation(step_program, "factor"), config.fraction);
+	gl.Uniform1ui(gl.GetUniformLocation(step_program, "steps"), config.stepping);
+	gl.Uniform2ui(gl.GetUniformLocation(step_program, "size"), render_width, render_height);
+	GLint skip_location = gl.GetUniformLocation(step_program, "skip");
+	gl.UseProgram(resolve_program);
+	gl.Uniform2ui(gl.GetUniformLocation(resolve_program, "size"), render_width, render_height);
+	gl.Uniform2ui(gl.GetUniformLocation(resolve_program, "screen"), screen_width, screen_height);
+	gl.Uniform1ui(gl.GetUniformLocation(resolve_program, "density_mode"), config.density);
+	gl.UseProgram(tone_program);
+	gl.Uniform2ui(gl.GetUniformLocation(tone_program, "screen"), screen_width, screen_height);
+	gl.Uniform1ui(gl.GetUniformLocation(tone_program, "density_mode"), config.density);
+	gl.Uniform1ui(gl.GetUniformLocation(tone_program, "tone"), config.tone == "gamma");
+	gl.Uniform1f(gl.GetUniformLocation(tone_program, "gamma"), config.gamma);
+	gl.Uniform3f(gl.GetUniformLocation(tone_program, "background"), CHAOS_BACKGROUND[0], CHAOS_BACKGROUND[1], CHAOS_BACKGROUND[2]);
+	gl.Uniform3f(gl.GetUniformLocation(tone_program, "foreground"), CHAOS_POINTS[0], CHAOS_POINTS[1], CHAOS_POINTS[2]);
+
+	std::cout << "Running " << GPU_WALKERS << " walkers on the GPU, " << config.stepping << " iterations each per frame." << std::endl;
+	uint64_t iterations = 0;
+	uint32_t new_points = 0;
+	Convergence convergence = {0, 0, 0, 0.0};
+	Convergence saturation = convergence;
+	bool saturated = false;
+	uint32_t last_convergence = SDL_GetTicks();
+	FrameStats stats;
+	reset_stats(stats, 0, 0);
+	std::vector<std::string> stats_summary(1, "collecting statistics");
+	std::vector<SDL_Rect> overlay;
+	SDL_Event event;
+	while (!engine.stopped()){
+		uint32_t frame_start = SDL_GetTicks();
+		stats.frames++;
+
+		// Run the walkers, the first frame burning them in. Dispatches usually return before the GPU is
+		// done, in which case the GPU time shows in the present phase, where the swap waits for it.
+		gl.UseProgram(step_program);
+		gl.Uniform1ui(skip_location, iterations == 0 ? engine.burn_in() : 0);
+		gl.DispatchCompute(GPU_WALKERS / GPU_GROUP, 1, 1);
+		gl.MemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		iterations += uint64_t (GPU_WALKERS) * config.stepping;
+
+		// Resolve the density to the window and tone map it, starting from a peak of 0
+		gl.BindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[GPU_COUNTERS]);
+		gl.BufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(uint32_t), sizeof(uint32_t), &counters_zero[1]);
+		gl.UseProgram(resolve_program);
+		gl.DispatchCompute((screen_width + 7) / 8, (screen_height + 7) / 8, 1);
+		gl.MemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		gl.UseProgram(tone_program);
+		gl.DispatchCompute((screen_width + 7) / 8, (screen_height + 7) / 8, 1);
+		gl.MemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+		lap_phase(stats, PHASE_DRAW);
+
+		// Copy the image to the screen and draw the vertices, and the statistics overlay on a box of background
+		gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		gl.BlitFramebuffer(0, 0, screen_width, screen_height, 0, 0, screen_width, screen_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		gl.Enable(GL_SCISSOR_TEST);
+		gl.ClearColor(CHAOS_VERTICES[0] / 255.0f, CHAOS_VERTICES[1] / 255.0f, CHAOS_VERTICES[2] / 255.0f, 1.0f);
+		for (uint32_t v = 0; v < num_vertices; v++){
+			uint32_t index = view_index(engine, vertices[v].x, vertices[v].y);
+			gl.Scissor(index % screen_width, screen_height - 1 - index / screen_width, RECTS_WIDTH, RECTS_HEIGHT);
+			gl.Clear(GL_COLOR_BUFFER_BIT);
+		}
+		if (flag_overlay){
+			SDL_Rect box = overlay_rects(stats_summary, overlay);
+			gl.ClearColor(CHAOS_BACKGROUND[0] / 255.0f, CHAOS_BACKGROUND[1] / 255.0f, CHAOS_BACKGROUND[2] / 255.0f, 1.0f);
+			gl.Scissor(box.x, screen_height - box.y - box.h, box.w, box.h);
+			gl.Clear(GL_COLOR_BUFFER_BIT);
+			gl.ClearColor(COLOUR_OVERLAY[0] / 255.0f, COLOUR_OVERLAY[1] / 255.0f, COLOUR_OVERLAY[2] / 255.0f, 1.0f);
+			for (size_t r = 0; r < overlay.size(); r++){
+				gl.Scissor(overlay[r].x, screen_height - overlay[r].y - overlay[r].h, overlay[r].w, overlay[r].h);
+				gl.Clear(GL_COLOR_BUFFER_BIT);
+			}
+		}
+		gl.Disable(GL_SCISSOR_TEST);
+		SDL_GL_SwapWindow(window);
+		lap_phase(stats, PHASE_PRESENT);
+
+		// The new points counter is only read back when the convergence or the statistics are measured
+		bool measure = SDL_GetTicks() - last_convergence >= 1000;
+		bool summarize = stats_seconds(stats) >= stats_span();
+		if (flag_stop_saturated || measure || summarize){
+			gl.BindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[GPU_COUNTERS]);
+			gl.GetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(new_points), &new_points);
+		}
+		if (flag_stop_saturated && check_saturation(saturation, iterations, new_points)){
+			saturated = true;
+			engine.stop();
+		}
+		if (measure){
+			measure_convergence(convergence, iterations, new_points);
+			std::ostringstream title;
+			title << "Chaos Game - " << new_points << " points, " << convergence.rate << " new per million iterations (GPU)";
+			SDL_SetWindowTitle(window, title.str().c_str());
+			last_convergence = SDL_GetTicks();
+		}
+		if (summarize){
+			stats_summary = stats_lines(stats, iterations, new_points);
+			if (stats_interval > 0){
+				log_stats(stats_summary);
+			}
+			reset_stats(stats, iterations, new_points);
+		}
+		lap_phase(stats, PHASE_OTHER);
+
+		// Handle events until the next frame is due
+		bool waiting = true;
+		while (waiting && !engine.stopped()){
+			int32_t remaining = fps > 0 ? int32_t (1000u / fps) - int32_t (SDL_GetTicks() - frame_start) : 0;
+			bool pending = remaining > 0 ? SDL_WaitEventTimeout(&event, remaining) : SDL_PollEvent(&event);
+			lap_phase(stats, remaining > 0 ? PHASE_DELAY : PHASE_EVENTS);
+			if (!pending){
+				waiting = remaining > 0;
+				continue;
+			}
+			if (is_quit_event(event)){
+				engine.stop();
+			}
+			else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_s){
+				flag_overlay = !flag_overlay;
+			}
+			lap_phase(stats, PHASE_EVENTS);
+		}
+	}
 	std::cout << std::endl << "Exiting." << std::endl;
-	flag_continue = false;
+
+	// A saturated game is finished, so its image is written as in headless mode
+	if (saturated){
+		std::cout << "Saturated after " << iterations << " iterations: " << saturation.rate
+			<< " new points per million iterations over the last " << saturation.window << " iterations." << std::endl;
+		if (!read_gpu_density(gl, buffers[GPU_DENSITY], engine) || !engine.write_image(output_path, image_format)){
+			std::cerr << "Could not write image to " << output_path << "." << std::endl;
+		}
+		else{
+			std::cout << "Image written to " << output_path << "." << std::endl;
+		}
+	}
+
+	// Free and destroy
+	gl.DeleteFramebuffers(1, &framebuffer);
+	gl.DeleteTextures(1, &image);
+	gl.DeleteBuffers(num_buffers, buffers);
+	gl.DeleteProgram(step_program);
+	gl.DeleteProgram(resolve_program);
+	gl.DeleteProgram(tone_program);
+	SDL_GL_DeleteContext(context);
+	SDL_DestroyWindow(window);
+	SDL_Quit();
+	return 0;
+}
+
+/**
+* Parses dimensions in the form "XxY".
+* @param max: The largest valid width or height
+* @return true if the dimensions are valid, in which case width and height are set.
+*/
+template <class T>
+bool parse_dimensions(const std::string &arg, T &width, T &height, uint64_t max){
+	std::stringstream ss(arg);
+	std::string item;
+	std::vector<uint64_t> split_strings;
+	int num_items = 0;
+	while (std::getline(ss, item, 'x')){
+		split_strings.push_back(std::strtoull(item.c_str(), nullptr, 10));
+		num_items++;
+	}
+	if (num_items != 2 || split_strings[0] == 0 || split_strings[1] == 0 || split_strings[0] > max || split_strings[1] > max){
+		return false;
+	}
+	width = split_strings[0];
+	height = split_strings[1];
+	return true;
 }
 
 /**
-* Hashes the x and y coordinates of a point.
+* Parses the whitespace-separated terms of a sweep, printing what is swept.
 */
-double hash_point(int x, int y){
-	return x/PRIME_1 + y/PRIME_2;
+void parse_sweep(const std::string &arg){
+	std::stringstream ss(arg);
+	std::string term;
+	while (ss >> term){
+		if (parse_sweep_term(term, sweep_vertices, sweep_factors)){
+			flag_sweep = true;
+			std::cout << "Sweep set to " << term << "." << std::endl;
+		}
+		else{
+			std::cout << "Invalid sweep " << term << ". Ignoring it." << std::endl;
+		}
+	}
+}
+
+/**
+* Parses the terms of an animation, "fraction=A:B", printing what is animated.
+*/
+void parse_animate(const std::string &arg){
+	std::string value = arg.compare(0, 9, "fraction=") == 0 ? arg.substr(9) : "";
+	std::replace(value.begin(), value.end(), ':', ' ');
+	std::stringstream ss(value);
+	double first, last;
+	if (!(ss >> first >> last) || first <= 0.0 || first >= 1.0 || last <= 0.0 || last >= 1.0){
+		std::cout << "Invalid animation " << arg << ". Ignoring it." << std::endl;
+		return;
+	}
+	flag_animate = true;
+	animate_first = first;
+	animate_last = last;
+	std::cout << "Animation set to a fraction from " << animate_first << " to " << animate_last << "." << std::endl;
 }
 
 int main(int argc, char *argv[]){
 	signal(SIGINT, signal_interrupt);
-	srand(time(0));
+
+	// The walkers are seeded from the current time unless --seed is given
+	config.seed = time(0);
+	std::string ifs_path;
+
+	// A point stream or the frames of an animation to stdout need stdout to themselves, so messages go to stderr instead
+	std::streambuf *stdout_buffer = std::cout.rdbuf();
+	bool animate = false, output_stdout = false;
+	for (int i = 1; i < argc; i++){
+		std::string arg = argv[i], next = i + 1 < argc ? argv[i + 1] : "";
+		if (arg == "--stream=-" || (arg == "--stream" && next == "-")){
+			std::cout.rdbuf(std::cerr.rdbuf());
+		}
+		animate = animate || arg == "--animate" || arg.compare(0, 10, "--animate=") == 0;
+		output_stdout = output_stdout || arg == "--output=-" || arg == "-o-" || ((arg == "-o" || arg == "--output") && next == "-");
+	}
+	if (animate && output_stdout){
+		std::cout.rdbuf(std::cerr.rdbuf());
+	}
 
 	// Process passed arguments
 	int opt;
-	while((opt = getopt_long(argc, argv, "hs:d:v:f:", long_opts, &optind)) != EOF){
+	std::vector<std::string> items;
+	while((opt = getopt_long(argc, argv, "hs:d:v:f:n:o:t:", long_opts, &optind)) != EOF){
 		switch(opt){
 			case 'h':
 				std::cout << "Options:" << std::endl;
-				std::cout << " -v N, --vertices N          number of vertices in the polygon (default: " << num_vertices << ")" << std::endl;
-				std::cout << " -f N, --fraction N          fraction of distance between the current point and chosen vertex to place a new point (default: " << factor << ")" << std::endl;
-				std::cout << " -s N, --stepping N          number of points to generate before refreshing the window (default: " << stepping << ")" << std::endl;
-				std::cout << " -d N, --frame-delay N       delay in ms after the window is refreshed (default: " << frame_delay_ms << ")" << std::endl;
+				std::cout << " -v N, --vertices N          number of vertices in the polygon (default: " << config.vertices << ")" << std::endl;
+				std::cout << " -f N, --fraction N          fraction of distance between the current point and chosen vertex to place a new point (default: " << config.fraction << ")" << std::endl;
+				std::cout << " -s N, --stepping N          number of points each walker generates before handing them to the window (default: " << config.stepping << ")" << std::endl;
+				std::cout << " --fps N                     number of window refreshes per second, 0 for unlimited (default: " << fps << ")" << std::endl;
+				std::cout << " -d N, --frame-delay N       delay in ms between window refreshes, same as --fps 1000/N" << std::endl;
 				std::cout << " --dimensions XxY            screen dimensions (default: " << screen_width << "x" << screen_height << ")" << std::endl;
+				std::cout << " --headless                  render to an image file without opening a window" << std::endl;
+				std::cout << " -n N, --iterations N        number of points to generate in headless mode (default: " << config.iterations << ")" << std::endl;
+				std::cout << " -o FILE, --output FILE      image written in headless mode, in the format of --format (default: " << output_path << ")" << std::endl;
+				std::cout << " --format NAME               image format: ppm (fastest) or png (smallest) (default: the extension of --output, or " << image_format << ")" << std::endl;
+				std::cout << " -t N, --threads N           number of walkers, each playing the game on its own thread (default: " << config.threads << ")" << std::endl;
+				std::cout << " --rng NAME                  random number generator: xoshiro256, pcg32 or splitmix (default: " << config.rng << ")" << std::endl;
+				std::cout << " --seed N                    seed of the random number streams (default: current time)" << std::endl;
+				std::cout << " --renderer NAME             renderer backend: target (rects drawn onto a texture) or streaming (pixel buffer upload) (default: " << RENDERER_NAMES[renderer_kind] << ")" << std::endl;
+				std::cout << " --kernel NAME               iteration kernel: scalar, simd (widest available), sse4, avx2, avx512, neon, fixed (Q32.32 integers), or lanes (the SIMD step rule one lane at a time) (default: " << config.kernel << ")" << std::endl;
+				std::cout << " --bench                     run -n iterations without rendering for every combination of the" << std::endl;
+				std::cout << "                             comma-separated values of --dimensions, -v, -f and -t, and report throughput" << std::endl;
+				std::cout << "                             to --output, or to stdout if it is not given" << std::endl;
+				std::cout << " --bench-format NAME         bench report format: csv or json (default: csv)" << std::endl;
+				std::cout << " --density                   count the hits on every pixel and tone map the counts, instead of marking pixels" << std::endl;
+				std::cout << " --tone NAME                 tone mapping of the density counts: log or gamma (default: " << config.tone << ")" << std::endl;
+				std::cout << " --gamma N                   gamma of the gamma tone mapping (default: " << config.gamma << ")" << std::endl;
+				std::cout << " --render-size XxY           dimensions of the grid the walkers play on, shown downsampled in the window (default: screen dimensions times supersampling)" << std::endl;
+				std::cout << " --supersample N             cells averaged into each written pixel along each axis (default: " << config.supersample << ")" << std::endl;
+				std::cout << " --tile-file FILE            keep the grid out of core in FILE, in headless mode" << std::endl;
+				std::cout << " --checkpoint FILE           write a checkpoint of the game to FILE periodically and on exit" << std::endl;
+				std::cout << " --checkpoint-interval N     seconds between checkpoints (default: " << checkpoint_interval << ")" << std::endl;
+				std::cout << " --resume FILE               resume the game saved in the checkpoint FILE, with its parameters" << std::endl;
+				std::cout << " --stream FILE               stream the generated points to FILE, a pipe, or stdout for -" << std::endl;
+				std::cout << " --stream-format NAME        records of the point stream: raw or varint (default: " << config.stream_format << ")" << std::endl;
+				std::cout << " --stream-points NAME        points streamed: all iterations or only new points (default: " << (config.stream_all ? "all" : "new") << ")" << std::endl;
+				std::cout << " --tile-memory N             megabytes of tiles mapped at a time in tiled mode (default: " << (config.tile_memory >> 20) << ")" << std::endl;
+				std::cout << " --stop-when-saturated       stop once new points are found at less than --saturation-rate, and write the image" << std::endl;
+				std::cout << " --saturation-rate N         new points per million iterations below which the image is saturated (default: " << saturation_rate << ")" << std::endl;
+				std::cout << " --backend NAME              where the window's walkers run: cpu or gpu (OpenGL 4.3 compute shaders) (default: " << BACKEND_NAMES[backend_kind] << ")" << std::endl;
+				std::cout << " --stats N                   write statistics of the run to stderr every N seconds" << std::endl;
+				std::cout << " --overlay                   show the statistics in the window, S toggles them" << std::endl;
+				std::cout << " --weights LIST              comma-separated weights of choosing each vertex (default: uniform)" << std::endl;
+				std::cout << " --restrict LIST             comma-separated offsets from the previous vertex that are never chosen, 0 forbids a repeat" << std::endl;
+				std::cout << " --ifs FILE                  run the affine maps in FILE, one \"weight a b c d e f\" per line, instead of the polygon" << std::endl;
+				std::cout << " --sweep TERMS               render every combination of vertices=A..B and fraction=A:B:STEP headless, one image each in the directory -o" << std::endl;
+				std::cout << " --jobs N                    number of sweep configurations run side by side on threads (default: one per hardware thread, 1 with --tile-file)" << std::endl;
+				std::cout << " --animate fraction=A:B      render --frames frames of the fraction going from A to B headless, into the directory -o or streamed to the file, pipe or stdout (-) it names" << std::endl;
+				std::cout << " --frames N                  number of frames of --animate (default: " << animate_frames << ")" << std::endl;
+				std::cout << " --coordinator PORT          wait on PORT for --nodes workers, merge the grids they send and write the image" << std::endl;
+				std::cout << " --nodes N                   number of workers of --coordinator (default: " << num_nodes << ")" << std::endl;
+				std::cout << " --worker HOST:PORT          render the game of the coordinator at HOST:PORT on its own random streams and send it the grid" << std::endl;
+				std::cout << " --burn-in N                 iterations each walker runs without recording them before its first point (default: enough to reach the attractor)" << std::endl;
 				std::cout << " -h, --help                  display this help page and exit" << std::endl;
 				std::cout << std::endl << std::endl;
 				return 0;
 
 			case 's':
 				if (std::atoi(optarg) > 0){
-					stepping = std::atoi(optarg);
-					std::cout << "Stepping set to " << stepping << "." << std::endl;
+					config.stepping = std::atoi(optarg);
+					std::cout << "Stepping set to " << config.stepping << "." << std::endl;
 				}
 				else{
-					std::cout << "Invalid stepping value. Defaulting to " << stepping << "." << std::endl;
+					std::cout << "Invalid stepping value. Defaulting to " << config.stepping << "." << std::endl;
 				}
 				break;
 
 			case 'd':
 				if (std::atoi(optarg) >= 0){
-					frame_delay_ms = std::atoi(optarg);
-					std::cout << "Frame delay set to " << frame_delay_ms << " ms." << std::endl;
+					fps = std::atoi(optarg) > 0 ? std::max(1000 / std::atoi(optarg), 1) : 0;
+					std::cout << "Frame delay set to " << std::atoi(optarg) << " ms (" << fps << " fps)." << std::endl;
 				}
 				else{
-					std::cout << "Invalid frame delay. Defaulting to " << frame_delay_ms << " ms." << std::endl;
+					std::cout << "Invalid frame delay. Defaulting to " << fps << " fps." << std::endl;
 				}
 				break;
 
-			case 'v':
-				if (std::atoi(optarg) >= 3 && std::atoi(optarg) <= 255){
-					num_vertices = std::atoi(optarg);
-					std::cout << "Number of vertices set to " << num_vertices << "." << std::endl;
+			case 'F':
+				if (std::atoi(optarg) >= 0 && std::atoi(optarg) <= 1000){
+					fps = std::atoi(optarg);
+					std::cout << "FPS set to " << fps << "." << std::endl;
 				}
 				else{
-					std::cout << "Invalid number of vertices. Defaulting to " << num_vertices << "." << std::endl;
+					std::cout << "Invalid FPS. Defaulting to " << fps << "." << std::endl;
+				}
+				break;
+
+			case 'v':
+				// Comma-separated values are benchmarked in turn, otherwise only the first is used
+				items = split_list(optarg);
+				bench_vertices.clear();
+				for (size_t i = 0; i < items.size(); i++){
+					if (std::atoi(items[i].c_str()) >= 3 && std::atoi(items[i].c_str()) <= 255){
+						bench_vertices.push_back(std::atoi(items[i].c_str()));
+						std::cout << "Number of vertices set to " << bench_vertices.back() << "." << std::endl;
+					}
+					else{
+						std::cout << "Invalid number of vertices. Defaulting to " << config.vertices << "." << std::endl;
+					}
+				}
+				if (!bench_vertices.empty()){
+					config.vertices = bench_vertices[0];
 				}
 				break;
 
 			case 'f':
-				if (std::atof(optarg) > 0.0 && std::atof(optarg) < 1.0){
-					factor = std::atof(optarg);
-					std::cout << "Factor set to " << factor << std::endl;
+				items = split_list(optarg);
+				bench_factors.clear();
+				for (size_t i = 0; i < items.size(); i++){
+					if (std::atof(items[i].c_str()) > 0.0 && std::atof(items[i].c_str()) < 1.0){
+						bench_factors.push_back(std::atof(items[i].c_str()));
+						std::cout << "Factor set to " << bench_factors.back() << std::endl;
+					}
+					else{
+						std::cout << "Invalid factor value. Defaulting to " << config.fraction << std::endl;
+					}
+				}
+				if (!bench_factors.empty()){
+					config.fraction = bench_factors[0];
+				}
+				break;
+
+			case 'H':
+				flag_headless = true;
+				break;
+
+			case 'n':
+				if (std::atoll(optarg) > 0){
+					config.iterations = std::atoll(optarg);
+					flag_iterations_set = true;
+					std::cout << "Iterations set to " << config.iterations << "." << std::endl;
 				}
 				else{
-					std::cout << "Invalid factor value. Defaulting to " << factor << std::endl;
+					std::cout << "Invalid number of iterations. Defaulting to " << config.iterations << "." << std::endl;
 				}
 				break;
 
-			case 'z':
-				// case for "dimensions" option, gathers dimensions from optarg in form "XxY".
-				std::stringstream ss(optarg);
-				std::string item;
-				std::vector<int> split_strings;
-				int num_items = 0;
-				while (std::getline(ss, item, 'x')){
-					split_strings.push_back(uint16_t (std::atoi(item.c_str())));
-					num_items++;
+			case 'o':
+				output_path = optarg;
+				flag_output_set = true;
+				break;
+
+			case 't':
+				items = split_list(optarg);
+				bench_threads.clear();
+				for (size_t i = 0; i < items.size(); i++){
+					if (std::atoi(items[i].c_str()) >= 1 && std::atoi(items[i].c_str()) <= 1024){
+						bench_threads.push_back(std::atoi(items[i].c_str()));
+						std::cout << "Threads set to " << bench_threads.back() << "." << std::endl;
+					}
+					else{
+						std::cout << "Invalid number of threads. Defaulting to " << config.threads << "." << std::endl;
+					}
 				}
-				if (num_items != 2 || split_strings[0] <= 0 || split_strings[1] <= 0){
-					std::cout << "Invalid screen dimensions. Defaulting to " << screen_width << "x" << screen_height << std::endl;
+				if (!bench_threads.empty()){
+					config.threads = bench_threads[0];
+				}
+				break;
+
+			case 'B':
+				flag_bench = true;
+				break;
+
+			case 'J':
+				if (std::string (optarg) == "csv" || std::string (optarg) == "json"){
+					flag_bench_json = std::string (optarg) == "json";
+					std::cout << "Bench format set to " << optarg << "." << std::endl;
+				}
+				else{
+					std::cout << "Invalid bench format. Defaulting to " << (flag_bench_json ? "json" : "csv") << "." << std::endl;
+				}
+				break;
+
+			case 'r':
+				if (std::string (optarg) == "xoshiro256" || std::string (optarg) == "pcg32" || std::string (optarg) == "splitmix"){
+					config.rng = optarg;
 				}
 				else{
-					screen_width = split_strings[0];
-					screen_height = split_strings[1];
+					std::cout << "Invalid random number generator. Defaulting to " << config.rng << "." << std::endl;
+					break;
 				}
+				std::cout << "Random number generator set to " << config.rng << "." << std::endl;
+				break;
+
+			case 'S':
+				config.seed = std::strtoull(optarg, nullptr, 10);
+				std::cout << "Seed set to " << config.seed << "." << std::endl;
 				break;
+
+			case 'e':
+				if (std::string (optarg) == "ppm" || std::string (optarg) == "png"){
+					image_format = optarg;
+				}
+				else{
+					std::cout << "Invalid format. Defaulting to " << image_format << "." << std::endl;
+					break;
+				}
+				flag_format_set = true;
+				std::cout << "Format set to " << image_format << "." << std::endl;
+				break;
+
+			case 'R':
+				if (std::string (optarg) == "target"){
+					renderer_kind = RENDERER_TARGET;
+				}
+				else if (std::string (optarg) == "streaming"){
+					renderer_kind = RENDERER_STREAMING;
+				}
+				else{
+					std::cout << "Invalid renderer. Defaulting to " << RENDERER_NAMES[renderer_kind] << "." << std::endl;
+					break;
+				}
+				std::cout << "Renderer set to " << RENDERER_NAMES[renderer_kind] << "." << std::endl;
+				break;
+
+			case 'k':
+				if (ChaosEngine::resolve_kernel(optarg).empty()){
+					std::cout << "Invalid kernel. Defaulting to " << config.kernel << "." << std::endl;
+					break;
+				}
+				config.kernel = ChaosEngine::resolve_kernel(optarg);
+				if (!ChaosEngine::kernel_supported(config.kernel)){
+					std::cout << "Kernel " << config.kernel << " is not supported on this CPU. Defaulting to scalar." << std::endl;
+					config.kernel = "scalar";
+				}
+				std::cout << "Kernel set to " << config.kernel << "." << std::endl;
+				break;
+
+			case 'D':
+				config.density = true;
+				break;
+
+			case 'T':
+				if (std::string (optarg) == "log" || std::string (optarg) == "gamma"){
+					config.tone = optarg;
+				}
+				else{
+					std::cout << "Invalid tone mapping. Defaulting to " << config.tone << "." << std::endl;
+					break;
+				}
+				std::cout << "Tone mapping set to " << config.tone << "." << std::endl;
+				break;
+
+			case 'G':
+				if (std::atof(optarg) > 0.0){
+					config.gamma = std::atof(optarg);
+					std::cout << "Gamma set to " << config.gamma << std::endl;
+				}
+				else{
+					std::cout << "Invalid gamma value. Defaulting to " << config.gamma << std::endl;
+				}
+				break;
+
+			case 'Z':
+				if (parse_dimensions(std::string (optarg), config.width, config.height, ChaosEngine::MAX_SIZE)){
+					flag_render_size_set = true;
+					std::cout << "Render size set to " << config.width << "x" << config.height << "." << std::endl;
+				}
+				else{
+					std::cout << "Invalid render size. Defaulting to the screen dimensions times the supersampling factor." << std::endl;
+				}
+				break;
+
+			case 'L':
+				config.tile_file = optarg;
+				std::cout << "Tile file set to " << config.tile_file << "." << std::endl;
+				break;
+
+			case 'M':
+				if (std::atoi(optarg) > 0){
+					config.tile_memory = uint64_t (std::atoi(optarg)) << 20;
+					std::cout << "Tile memory set to " << (config.tile_memory >> 20) << " MB." << std::endl;
+				}
+				else{
+					std::cout << "Invalid tile memory. Defaulting to " << (config.tile_memory >> 20) << " MB." << std::endl;
+				}
+				break;
+
+			case 'C':
+				flag_checkpoint = true;
+				checkpoint_path = optarg;
+				std::cout << "Checkpoint file set to " << checkpoint_path << "." << std::endl;
+				break;
+
+			case 'I':
+				if (std::atof(optarg) > 0.0){
+					checkpoint_interval = std::atof(optarg);
+					std::cout << "Checkpoint interval set to " << checkpoint_interval << " s." << std::endl;
+				}
+				else{
+					std::cout << "Invalid checkpoint interval. Defaulting to " << checkpoint_interval << " s." << std::endl;
+				}
+				break;
+
+			case 'U':
+				flag_resume = true;
+				resume_path = optarg;
+				break;
+
+			case 'P':
+				config.stream = optarg;
+				std::cout << "Point stream set to " << config.stream << "." << std::endl;
+				break;
+
+			case 'E':
+				if (std::string (optarg) == "raw" || std::string (optarg) == "varint"){
+					config.stream_format = optarg;
+				}
+				else{
+					std::cout << "Invalid stream format. Defaulting to " << config.stream_format << "." << std::endl;
+					break;
+				}
+				std::cout << "Stream format set to " << config.stream_format << "." << std::endl;
+				break;
+
+			case 'W':
+				if (std::string (optarg) == "all" || std::string (optarg) == "new"){
+					config.stream_all = std::string (optarg) == "all";
+					std::cout << "Streamed points set to " << optarg << "." << std::endl;
+				}
+				else{
+					std::cout << "Invalid streamed points. Defaulting to " << (config.stream_all ? "all" : "new") << "." << std::endl;
+				}
+				break;
+
+			case 'g':
+				if (std::string (optarg) == "cpu" || std::string (optarg) == "gpu"){
+					backend_kind = std::string (optarg) == "gpu" ? BACKEND_GPU : BACKEND_CPU;
+					std::cout << "Backend set to " << BACKEND_NAMES[backend_kind] << "." << std::endl;
+				}
+				else{
+					std::cout << "Invalid backend. Defaulting to " << BACKEND_NAMES[backend_kind] << "." << std::endl;
+				}
+				break;
+
+			case 'K':
+				if (std::atof(optarg) > 0.0){
+					stats_interval = std::atof(optarg);
+					std::cout << "Stats interval set to " << stats_interval << " s." << std::endl;
+				}
+				else{
+					std::cout << "Invalid stats interval. Defaulting to no stats." << std::endl;
+				}
+				break;
+
+			case 'O':
+				flag_overlay = true;
+				break;
+
+			case 'w':
+				if (parse_weights(optarg, config.weights)){
+					std::cout << "Vertex weights set to " << optarg << "." << std::endl;
+				}
+				else{
+					std::cout << "Invalid vertex weights " << optarg << ". Defaulting to uniform." << std::endl;
+				}
+				break;
+
+			case 'x':
+				items = split_list(optarg);
+				config.restricted.clear();
+				for (size_t i = 0; i < items.size(); i++){
+					double offset;
+					if (ChaosEngine::parse_number(items[i], offset) && offset == std::floor(offset) && offset >= 0 && offset <= 255){
+						config.restricted.push_back(uint16_t (offset));
+						std::cout << "Restricted offset " << config.restricted.back() << " from the previous vertex." << std::endl;
+					}
+					else{
+						std::cout << "Invalid restricted offset. Ignoring " << items[i] << "." << std::endl;
+					}
+				}
+				break;
+
+			case 'i':
+				ifs_path = optarg;
+				break;
+
+			case 'p':
+				parse_sweep(optarg);
+				break;
+
+			case 'q':
+				if (std::atoi(optarg) > 0 && std::atoi(optarg) <= 256){
+					sweep_jobs = std::atoi(optarg);
+					std::cout << "Sweep jobs set to " << sweep_jobs << "." << std::endl;
+				}
+				else{
+					std::cout << "Invalid number of sweep jobs. Defaulting to " << (sweep_jobs > 0 ? std::to_string(sweep_jobs) : "one per hardware thread") << "." << std::endl;
+				}
+				break;
+
+			case 'a':
+				parse_animate(optarg);
+				break;
+
+			case 'j':
+				worker_address = optarg;
+				std::cout << "Worker of coordinator " << worker_address << "." << std::endl;
+				break;
+
+			case 'c':
+				if (std::atoi(optarg) > 0 && std::atoi(optarg) <= 65535){
+					coordinator_port = std::atoi(optarg);
+					std::cout << "Coordinator port set to " << coordinator_port << "." << std::endl;
+				}
+				else{
+					std::cout << "Invalid coordinator port. Ignoring it." << std::endl;
+				}
+				break;
+
+			case 'N':
+				if (std::atoi(optarg) > 0 && std::atoi(optarg) <= 65535){
+					num_nodes = std::atoi(optarg);
+					std::cout << "Nodes set to " << num_nodes << "." << std::endl;
+				}
+				else{
+					std::cout << "Invalid number of nodes. Defaulting to " << num_nodes << "." << std::endl;
+				}
+				break;
+
+			case 'u':
+				if (std::atoi(optarg) > 0){
+					animate_frames = std::atoi(optarg);
+					std::cout << "Frames set to " << animate_frames << "." << std::endl;
+				}
+				else{
+					std::cout << "Invalid number of frames. Defaulting to " << animate_frames << "." << std::endl;
+				}
+				break;
+
+			case 'X':
+				flag_stop_saturated = true;
+				break;
+
+			case 'Y':
+				if (std::atof(optarg) > 0.0){
+					saturation_rate = std::atof(optarg);
+					std::cout << "Saturation rate set to " << saturation_rate << " new points per million iterations." << std::endl;
+				}
+				else{
+					std::cout << "Invalid saturation rate. Defaulting to " << saturation_rate << "." << std::endl;
+				}
+				break;
+
+			case 'b':
+				if (std::atoll(optarg) >= 0){
+					config.burn_in = std::atoll(optarg);
+					std::cout << "Burn-in set to " << config.burn_in << " iterations." << std::endl;
+				}
+				else{
+					std::cout << "Invalid burn-in. Defaulting to enough iterations to reach the attractor." << std::endl;
+				}
+				break;
+
+			case 'A':
+				if (std::atoi(optarg) > 0){
+					config.supersample = std::atoi(optarg);
+					std::cout << "Supersampling factor set to " << config.supersample << "." << std::endl;
+				}
+				else{
+					std::cout << "Invalid supersampling factor. Defaulting to " << config.supersample << "." << std::endl;
+				}
+				break;
+
+			case 'z':
+				// case for "dimensions" option, gathers dimensions from optarg in form "XxY".
+				items = split_list(optarg);
+				bench_dimensions.clear();
+				for (size_t i = 0; i < items.size(); i++){
+					uint16_t width, height;
+					if (parse_dimensions(items[i], width, height, UINT16_MAX)){
+						bench_dimensions.push_back(std::make_pair(width, height));
+					}
+					else{
+						std::cout << "Invalid screen dimensions. Defaulting to " << screen_width << "x" << screen_height << std::endl;
+					}
+				}
+				if (!bench_dimensions.empty()){
+					screen_width = bench_dimensions[0].first;
+					screen_height = bench_dimensions[0].second;
+				}
+				break;
+		}
+	}
+
+	// The terms of a sweep may follow it as separate arguments
+	for (int i = optind; i < argc; i++){
+		if (flag_sweep){
+			parse_sweep(argv[i]);
+		}
+		else{
+			std::cout << "Ignoring argument " << argv[i] << "." << std::endl;
 		}
 	}
 
-	// Storage for vertices and points
+	// Without --format, an image named .png is written as PNG, and without -o the image is named by its format
+	if (!flag_format_set && !flag_sweep && !flag_animate && output_path.size() > 4
+		&& output_path.compare(output_path.size() - 4, 4, ".png") == 0){
+		image_format = "png";
+	}
+	else if (flag_format_set && !flag_output_set){
+		output_path = std::string ("chaos.") + image_format;
+	}
+
+	// Distributed nodes run a single fresh game each, and only the coordinator writes the image
+	if (!worker_address.empty() && coordinator_port > 0){
+		std::cout << "A node is either a worker or the coordinator. Ignoring --coordinator." << std::endl;
+		coordinator_port = 0;
+	}
+	bool distributed = !worker_address.empty() || coordinator_port > 0;
+	if (distributed && (flag_sweep || flag_animate || flag_bench || flag_checkpoint || flag_resume || !config.stream.empty() || !config.tile_file.empty() || flag_stop_saturated)){
+		std::cout << "Distributed nodes run a fixed number of iterations into one grid. Ignoring sweeps, animations, --bench, checkpoints, the stream, the tile file and saturation." << std::endl;
+		flag_sweep = false;
+		flag_animate = false;
+		flag_bench = false;
+		flag_checkpoint = false;
+		flag_resume = false;
+		config.stream.clear();
+		config.tile_file.clear();
+		flag_stop_saturated = false;
+	}
+	if (distributed){
+		flag_headless = true;
+	}
+
+	// A sweep or an animation writes an image per configuration, which only headless mode does
+	if (flag_sweep && flag_animate){
+		std::cout << "A sweep and an animation cannot run together. Ignoring --animate." << std::endl;
+		flag_animate = false;
+	}
+	if ((flag_sweep || flag_animate) && (flag_bench || flag_checkpoint || flag_resume || !config.stream.empty())){
+		std::cout << "A " << (flag_sweep ? "sweep" : "animation") << " runs fresh configurations into images. Ignoring --bench, checkpoints and the stream." << std::endl;
+		flag_bench = false;
+		flag_checkpoint = false;
+		flag_resume = false;
+		config.stream.clear();
+	}
+	if (flag_sweep && !config.tile_file.empty() && sweep_jobs != 1){
+		if (sweep_jobs > 1){
+			std::cout << "Sweep jobs would share the tile file. Defaulting to 1 sweep job." << std::endl;
+		}
+		sweep_jobs = 1;
+	}
+	if (flag_sweep || flag_animate){
+		flag_headless = true;
+	}
+
+	// The maps of a file replace the polygon, and its weights those given by --weights
+	if (!ifs_path.empty()){
+		if (!ChaosEngine::read_ifs(ifs_path, config)){
+			std::cerr << "Could not read IFS from " << ifs_path << "." << std::endl;
+			return 1;
+		}
+		std::cout << "IFS set to " << config.vertices << " maps from " << ifs_path << "." << std::endl;
+	}
+
+	// IFS rules choose a vertex per step from its table, which only the scalar loop does
+	bool ifs = !config.weights.empty() || !config.restricted.empty() || !config.maps.empty();
+	if (ifs && config.kernel != "scalar"){
+		std::cout << "IFS rules run on the scalar kernel. Defaulting to scalar." << std::endl;
+		config.kernel = "scalar";
+	}
+	if (ifs && backend_kind == BACKEND_GPU){
+		std::cout << "The GPU backend does not run IFS rules. Defaulting to cpu." << std::endl;
+		backend_kind = BACKEND_CPU;
+	}
+
+	// The tile file is written by walkers that run to completion, so it is only used without a window
+	if (!config.tile_file.empty() && (!flag_headless || flag_bench)){
+		std::cout << "Tiled mode needs headless mode, without --bench. Ignoring the tile file." << std::endl;
+		config.tile_file.clear();
+	}
+
+	// Tiled mode only counts new points when flushing its bins, so it can only stream every iteration
+	if (!config.tile_file.empty() && !config.stream.empty() && !config.stream_all){
+		std::cout << "Tiled mode can only stream every iteration. Defaulting to all." << std::endl;
+		config.stream_all = true;
+	}
+	if (flag_bench && !config.stream.empty()){
+		std::cout << "Bench mode does not stream points. Ignoring the stream." << std::endl;
+		config.stream.clear();
+	}
+
+	// Checkpoints hold a resident grid, the tile file already persists its own
+	if (!config.tile_file.empty() && (flag_checkpoint || flag_resume)){
+		std::cout << "Checkpoints are not supported in tiled mode. Ignoring the checkpoint files." << std::endl;
+		flag_checkpoint = false;
+		flag_resume = false;
+	}
+
+	// The GPU keeps the game on the device and draws it in the window
+	if (backend_kind == BACKEND_GPU && (flag_headless || flag_bench)){
+		std::cout << "The GPU backend needs a window. Defaulting to cpu." << std::endl;
+		backend_kind = BACKEND_CPU;
+	}
+	if (backend_kind == BACKEND_GPU && (flag_checkpoint || flag_resume || !config.stream.empty())){
+		std::cout << "The GPU backend keeps the game on the device. Ignoring checkpoints and the stream." << std::endl;
+		flag_checkpoint = false;
+		flag_resume = false;
+		config.stream.clear();
+	}
+
+	if (flag_bench && flag_stop_saturated){
+		std::cout << "Bench mode runs a fixed number of iterations. Ignoring --stop-when-saturated." << std::endl;
+		flag_stop_saturated = false;
+	}
+
+	if (flag_bench){
+		return run_bench();
+	}
+
+	// A resumed game takes over every parameter of the checkpoint, but an explicit number of iterations
+	// extends or shortens the resumed run instead
+	if (flag_resume){
+		uint64_t iterations = config.iterations, resumed;
+		if (!read_snapshot(resume_path, resume_snapshot) || !ChaosEngine::snapshot_config(resume_snapshot, config, resumed)){
+			std::cerr << "Could not read checkpoint from " << resume_path << "." << std::endl;
+			return 1;
+		}
+		flag_render_size_set = true;
+		if (flag_iterations_set){
+			config.iterations = iterations;
+		}
+		std::cout << "Resuming " << resume_path << " after " << resumed << " iterations." << std::endl;
+	}
+
+	// Headless runs stopping on saturation only stop at an explicit number of iterations
+	if (flag_stop_saturated && !flag_iterations_set){
+		config.iterations = UINT64_MAX;
+	}
+
+	if (!worker_address.empty()){
+		return run_worker();
+	}
+	if (coordinator_port > 0){
+		return run_coordinator();
+	}
+	if (flag_sweep){
+		return run_sweep();
+	}
+	if (flag_animate){
+		return run_animation(stdout_buffer);
+	}
+
+	// Density counts are tone mapped into the whole pixel buffer every frame, and grids larger than the
+	// screen blend several cells into each pixel, which the target renderer cannot do
+	render_size();
+	bool downsampled = config.width != screen_width || config.height != screen_height;
+	if ((config.density || downsampled) && renderer_kind == RENDERER_TARGET){
+		std::cout << (config.density ? "Density mode" : "A render size other than the screen dimensions")
+			<< " needs the streaming renderer. Defaulting to streaming." << std::endl;
+		renderer_kind = RENDERER_STREAMING;
+	}
+
+	// The window takes the walkers' new points to draw them, and zooms into a view of the screen's size.
+	// The GPU runs walkers of its own, and only falls back on the engine's when it cannot run.
+	if (!flag_headless){
+		config.record_points = !config.density;
+		config.view_width = screen_width;
+		config.view_height = screen_height;
+	}
+
+	// Create the vertices of the polygon, the occupancy grid and the walkers, and open the point stream
+	std::string error;
+	std::unique_ptr<ChaosEngine> engine = ChaosEngine::create(config, &error);
+	if (!engine){
+		std::cerr << error << std::endl;
+		return 1;
+	}
+	if (flag_resume && !engine->restore(resume_snapshot)){
+		std::cerr << "Checkpoint " << resume_path << " does not match its parameters, it may be truncated or corrupt." << std::endl;
+		return 1;
+	}
+
+	if (flag_headless){
+		return run_headless(*engine, config, output_path, nullptr, std::cout);
+	}
+	if (backend_kind == BACKEND_GPU){
+		int status = run_gpu(*engine);
+		if (status != GPU_UNAVAILABLE){
+			return status;
+		}
+		std::cout << "Could not run on the GPU. Defaulting to cpu." << std::endl;
+	}
+
+	// Storage for points discovered since the last frame, and drawn vertices
+	std::vector<ChaosPoint> points;
 	std::vector<SDL_Rect> rects;
-	std::unordered_map<double, bool> rects_hashmap;
-	Vertex vertices[num_vertices];
-	SDL_Rect vertice_rects[num_vertices];
+	std::vector<ChaosVertex> vertices = engine->vertices();
+	std::vector<SDL_Rect> vertice_rects(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++){
+		uint32_t index = view_index(*engine, vertices[i].x, vertices[i].y);
+		vertice_rects[i] = SDL_Rect {int (index % screen_width), int (index / screen_width), RECTS_WIDTH, RECTS_HEIGHT};
+	}
 
 	// Initialize SDL
 	if (SDL_Init(SDL_INIT_VIDEO) != 0){
@@ -182,7 +1685,7 @@ int main(int argc, char *argv[]){
 	}
 
 	// Create renderer
-	SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, 0);	
+	SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_TARGETTEXTURE);	
 	if (renderer == nullptr){
 		log_SDL_error("CreateRenderer");
 		SDL_DestroyWindow(window);
@@ -190,83 +1693,194 @@ int main(int argc, char *argv[]){
 		return 1;
 	}
 
-	// Create the vertices of the polygon
-	uint16_t x_point, y_point;
-	float theta;
-	for (int i = 0; i < num_vertices; i++){
-		theta = 270 + float (i * 360) / float (num_vertices);
-		x_point = screen_width/2 + cos(theta*M_PI/180) * (screen_width * (1.0 - SCREEN_MARGINS) / 2);
-		y_point = screen_height/2 + sin(theta*M_PI/180) * (screen_height * (1.0 - SCREEN_MARGINS) / 2);
-		vertices[i] = {uint16_t (x_point), uint16_t (y_point)};
-		vertice_rects[i] = SDL_Rect {x_point, y_point, RECTS_WIDTH, RECTS_HEIGHT};
+	// Create the canvas, a persistent texture that accumulates the points across frames.
+	// The target renderer draws onto it directly, the streaming renderer uploads the pixel buffer to it.
+	SDL_Texture *canvas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+		renderer_kind == RENDERER_TARGET ? SDL_TEXTUREACCESS_TARGET : SDL_TEXTUREACCESS_STREAMING,
+		screen_width, screen_height);
+	if (canvas == nullptr){
+		log_SDL_error("CreateTexture");
+		SDL_DestroyRenderer(renderer);
+		SDL_DestroyWindow(window);
+		SDL_Quit();
+		return 1;
 	}
+	if (renderer_kind == RENDERER_STREAMING){
+		pixels.assign(uint32_t (screen_width) * screen_height, ChaosEngine::argb(CHAOS_BACKGROUND));
+		view_hits.assign(pixels.size(), 0);
+	}
+
+	// Draw the grid of a resumed game on the first frame
+	clear_canvas(*engine, renderer, canvas, rects);
+	uint32_t last_checkpoint = SDL_GetTicks();
 
-	// Reserve some space in the hashmap, which will likely be expanded
-	rects_hashmap.reserve(0.05 * screen_width * screen_height);
+	// The convergence is measured once a second on the progress the walkers published, and shown in the title
+	Convergence convergence = {0, 0, 0, 0.0};
+	engine->progress(convergence.iterations, convergence.points);
+	uint32_t last_convergence = SDL_GetTicks();
+	Convergence saturation = convergence;
+	bool saturated = false;
+	FrameStats stats;
+	reset_stats(stats, convergence.iterations, convergence.points);
+	std::vector<std::string> stats_summary(1, "collecting statistics");
+	std::vector<SDL_Rect> overlay;
 
-	// Create the first point
-	uint16_t last_x_point, last_y_point;
-	last_x_point = rand() % screen_width;
-	last_y_point = rand() % screen_height;
-	rects.push_back(SDL_Rect {last_x_point, last_y_point, RECTS_WIDTH, RECTS_HEIGHT});
+	// Run the walkers continuously on their own threads, while this thread presents their points
+	engine->start();
 	
-	// Keep generating points until flag_continue is set to false
-	uint8_t die_roll;
-	double hash;
+	// Keep presenting points until the game is stopped
 	SDL_Event event;
-	uint32_t i = 0;
-	uint32_t num_rects = 0;
-	while (flag_continue){
-		// Roll the die and determine the next point's position
-		die_roll = rand() % num_vertices;
-		x_point = round(last_x_point * (1.0 - factor) + vertices[die_roll].x * factor);
-		y_point = round(last_y_point * (1.0 - factor) + vertices[die_roll].y * factor);
-		
-		// Hash the new point's position and check if it has already been created.
-		// If the point does not exist, create it.
-		hash = hash_point(x_point, y_point);
-		if (rects_hashmap[hash] == false){
-			rects_hashmap[hash] = true;
-			num_rects++;
-			rects.push_back(SDL_Rect {x_point, y_point, RECTS_WIDTH, RECTS_HEIGHT});
-		}
-
-		last_x_point = x_point;
-		last_y_point = y_point;
-
-		if (i % stepping == 0){
-			// Clear renderer
-			SDL_SetRenderDrawColor(renderer, colour_background[0], colour_background[1], colour_background[2], 0xFF);
-			SDL_RenderClear(renderer);
-
-			// Draw generated points
-			SDL_SetRenderDrawColor(renderer, colour_points[0], colour_points[1], colour_points[2], 0xFF);
-			SDL_RenderFillRects(renderer, &rects[0], num_rects);
-
-			// Draw vertices
-			SDL_SetRenderDrawColor(renderer, colour_vertices[0], colour_vertices[1], colour_vertices[2], 0xFF);
-			SDL_RenderFillRects(renderer, vertice_rects, num_vertices);
-
-			// Update screen
-			SDL_RenderPresent(renderer);
-			SDL_Delay(frame_delay_ms);
-		}
-
-		// Check if the window's exit button has been pressed. If so, quit the game.
-		while (SDL_PollEvent(&event)){
-			if (event.type == SDL_QUIT){
-				std::cout << std::endl << "Exiting." << std::endl;
-				flag_continue = false;
+	while (!engine->stopped()){
+		uint32_t frame_start = SDL_GetTicks();
+		stats.frames++;
+
+		// Take the points the walkers discovered since the last frame
+		engine->take_points(points);
+		lap_phase(stats, PHASE_TAKE);
+
+		if (renderer_kind == RENDERER_TARGET){
+			// Draw the new points onto the canvas
+			for (size_t p = 0; p < points.size(); p++){
+				rects.push_back(SDL_Rect {int (points[p].x), int (points[p].y), RECTS_WIDTH, RECTS_HEIGHT});
+			}
+			SDL_SetRenderTarget(renderer, canvas);
+			SDL_SetRenderDrawColor(renderer, CHAOS_POINTS[0], CHAOS_POINTS[1], CHAOS_POINTS[2], 0xFF);
+			SDL_RenderFillRects(renderer, rects.data(), rects.size());
+			rects.clear();
+			SDL_SetRenderTarget(renderer, nullptr);
+		}
+		else{
+			// Blend the new points into the pixel buffer by the coverage of their pixels, or tone map the
+			// density counts into it, and upload it in one go
+			if (config.density){
+				engine->framebuffer(pixels, screen_width, screen_height);
+			}
+			// Points of the zoomed view are window pixels already
+			for (size_t p = 0; p < points.size(); p++){
+				uint32_t index = flag_zoomed ? points[p].y * screen_width + points[p].x : view_index(*engine, points[p].x, points[p].y);
+				view_hits[index]++;
+				pixels[index] = ChaosEngine::blend(flag_zoomed ? 1.0f : float (view_hits[index]) / view_cells(*engine, index));
+			}
+			SDL_UpdateTexture(canvas, nullptr, pixels.data(), screen_width * sizeof(uint32_t));
+		}
+		points.clear();
+		lap_phase(stats, PHASE_DRAW);
+
+		// Copy the canvas to the screen
+		SDL_RenderCopy(renderer, canvas, nullptr, nullptr);
+
+		// Draw vertices, which are only in place in the whole grid
+		if (!flag_zoomed){
+			SDL_SetRenderDrawColor(renderer, CHAOS_VERTICES[0], CHAOS_VERTICES[1], CHAOS_VERTICES[2], 0xFF);
+			SDL_RenderFillRects(renderer, vertice_rects.data(), vertice_rects.size());
+		}
+
+		// Draw the statistics overlay on a box of background
+		if (flag_overlay){
+			SDL_Rect box = overlay_rects(stats_summary, overlay);
+			SDL_SetRenderDrawColor(renderer, CHAOS_BACKGROUND[0], CHAOS_BACKGROUND[1], CHAOS_BACKGROUND[2], 0xFF);
+			SDL_RenderFillRect(renderer, &box);
+			SDL_SetRenderDrawColor(renderer, COLOUR_OVERLAY[0], COLOUR_OVERLAY[1], COLOUR_OVERLAY[2], 0xFF);
+			SDL_RenderFillRects(renderer, overlay.data(), overlay.size());
+		}
+
+		// Update screen
+		SDL_RenderPresent(renderer);
+		lap_phase(stats, PHASE_PRESENT);
+
+		// The zoomed view finds no points of the whole grid, so saturation is only checked in the whole grid
+		uint64_t published_iterations = 0, published_points = 0;
+		if (flag_stop_saturated && !flag_zoomed){
+			engine->progress(published_iterations, published_points);
+			if (check_saturation(saturation, published_iterations, published_points)){
+				saturated = true;
+				engine->stop();
 			}
 		}
+		if (SDL_GetTicks() - last_convergence >= 1000){
+			engine->progress(published_iterations, published_points);
+			measure_convergence(convergence, published_iterations, published_points);
+			std::ostringstream title;
+			title << "Chaos Game - " << published_points << " points, " << convergence.rate << " new per million iterations";
+			SDL_SetWindowTitle(window, title.str().c_str());
+			last_convergence = SDL_GetTicks();
+		}
 
-		i++;
+		// Snapshot the game while the walkers are parked, the checkpoint is written in the background
+		if (flag_checkpoint && SDL_GetTicks() - last_checkpoint >= checkpoint_interval * 1000){
+			engine->checkpoint(checkpoint_path, false);
+			last_checkpoint = SDL_GetTicks();
+		}
+
+		// Summarize the statistics at the end of their span
+		if (stats_seconds(stats) >= stats_span()){
+			engine->progress(published_iterations, published_points);
+			stats_summary = stats_lines(stats, published_iterations, published_points);
+			if (stats_interval > 0){
+				log_stats(stats_summary);
+			}
+			reset_stats(stats, published_iterations, published_points);
+		}
+		lap_phase(stats, PHASE_OTHER);
+
+		// Handle events until the next frame is due, while the walkers keep generating points.
+		// Waiting on the event queue rather than sleeping keeps quitting responsive within a frame.
+		bool waiting = true;
+		while (waiting && !engine->stopped()){
+			int32_t remaining = fps > 0 ? int32_t (1000u / fps) - int32_t (SDL_GetTicks() - frame_start) : 0;
+			bool pending = remaining > 0 ? SDL_WaitEventTimeout(&event, remaining) : SDL_PollEvent(&event);
+			lap_phase(stats, remaining > 0 ? PHASE_DELAY : PHASE_EVENTS);
+			if (!pending){
+				waiting = remaining > 0;
+				continue;
+			}
+
+			if (is_quit_event(event)){
+				engine->stop();
+			}
+			else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_s){
+				flag_overlay = !flag_overlay;
+			}
+			// A new view is rendered from scratch, and saturation measured afresh once back in the whole grid
+			else if (view_event(event, *engine)){
+				clear_canvas(*engine, renderer, canvas, rects);
+				engine->progress(published_iterations, published_points);
+				saturation = Convergence {published_iterations, published_points, 0, 0.0};
+			}
+			// The canvas contents were lost, so redraw every point on the next frame
+			else if (event.type == SDL_RENDER_TARGETS_RESET && renderer_kind == RENDERER_TARGET){
+				if (flag_zoomed){
+					set_view(*engine, view_center_x, view_center_y, view_zoom);
+				}
+				clear_canvas(*engine, renderer, canvas, rects);
+			}
+			lap_phase(stats, PHASE_EVENTS);
+		}
+	}
+	std::cout << std::endl << "Exiting." << std::endl;
+
+	engine->stop();
+	if (flag_checkpoint){
+		engine->checkpoint(checkpoint_path, true);
+		std::cout << "Checkpoint written to " << checkpoint_path << "." << std::endl;
+	}
+
+	// A saturated game is finished, so its image is written as in headless mode
+	if (saturated){
+		std::cout << "Saturated after " << engine->iterations() << " iterations: " << saturation.rate
+			<< " new points per million iterations over the last " << saturation.window << " iterations." << std::endl;
+		if (!engine->write_image(output_path, image_format)){
+			std::cerr << "Could not write image to " << output_path << "." << std::endl;
+		}
+		else{
+			std::cout << "Image written to " << output_path << "." << std::endl;
+		}
 	}
 
 	// Free and destroy
-	std::vector<SDL_Rect>().swap(rects);
-	SDL_DestroyWindow(window);
+	SDL_DestroyTexture(canvas);
 	SDL_DestroyRenderer(renderer);
+	SDL_DestroyWindow(window);
 	SDL_Quit();
 	return 0;
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -0,0 +1,994 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <signal.h>
+#include <unistd.h>
+#include <sstream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include <iterator>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <cmath>
+#include <cstring>
+#include <cerrno>
+
+#include "chaos_engine.h"
+#include "chaos_program.h"
+
+// The options are documented in chaos_program.h
+
+ChaosConfig config;
+bool flag_render_size_set = false;
+
+uint16_t screen_width = 1000;
+uint16_t screen_height = 1000;
+
+bool flag_headless = false;
+bool flag_iterations_set = false;
+std::string output_path = "chaos.ppm";
+bool flag_output_set = false;
+std::string image_format = "ppm";
+bool flag_format_set = false;
+
+bool flag_stop_saturated = false;
+double saturation_rate = 1.0;
+const double SATURATION_POINTS = 10.0;
+
+const char *PHASE_NAMES[] = {"take", "draw", "present", "other", "events", "delay"};
+double stats_interval = 0;
+
+bool flag_bench = false;
+bool flag_bench_json = false;
+std::vector<std::pair<uint16_t, uint16_t>> bench_dimensions;
+std::vector<uint16_t> bench_vertices;
+std::vector<float> bench_factors;
+std::vector<uint16_t> bench_threads;
+
+bool flag_sweep = false;
+std::vector<uint16_t> sweep_vertices;
+std::vector<float> sweep_factors;
+uint16_t sweep_jobs = 0;
+
+bool flag_animate = false;
+float animate_first = 0.3f, animate_last = 0.7f;
+uint32_t animate_frames = 100;
+
+bool flag_checkpoint = false;
+std::string checkpoint_path;
+double checkpoint_interval = 60;
+bool flag_resume = false;
+std::string resume_path;
+std::vector<uint8_t> resume_snapshot;
+
+std::string worker_address;
+uint16_t coordinator_port = 0;
+uint16_t num_nodes = 1;
+const char JOB_MAGIC[8] = {'C', 'H', 'A', 'O', 'S', 'J', 'O', 'B'};
+const int WORKER_CONNECT_SECONDS = 30;
+
+// Headless runs step the walkers in segments of this many iterations, between which they measure the
+// convergence and take checkpoints
+const uint64_t HEADLESS_SEGMENT = 1 << 24;
+
+/**
+* Splits a comma-separated option argument into its items.
+*/
+std::vector<std::string> split_list(const std::string &arg){
+	std::stringstream ss(arg);
+	std::string item;
+	std::vector<std::string> items;
+	while (std::getline(ss, item, ',')){
+		items.push_back(item);
+	}
+	return items;
+}
+
+/**
+* Parses comma-separated vertex weights, which must be numbers, none negative and one at least positive.
+* @param weights: Set to the weights if they are valid, and cleared, for uniform weights, otherwise
+* @return true if the weights are valid.
+*/
+bool parse_weights(const std::string &arg, std::vector<float> &weights){
+	std::vector<std::string> items = split_list(arg);
+	weights.clear();
+	bool weighted = false;
+	for (size_t i = 0; i < items.size(); i++){
+		double weight;
+		if (!ChaosEngine::parse_number(items[i], weight) || weight < 0){
+			weights.clear();
+			return false;
+		}
+		weights.push_back(weight);
+		weighted = weighted || weights.back() > 0;
+	}
+	if (!weighted){
+		weights.clear();
+	}
+	return weighted;
+}
+
+/**
+* Parses a sweep term, "vertices=A..B" or "fraction=A:B:STEP", into the swept vertex counts or fractions.
+* Either may also be a single value or a comma-separated list; ranges include both ends, and expand to at most
+* MAX_SWEEP_VALUES values.
+* @param vertices: Set to the vertex counts of a valid vertices term
+* @param factors: Set to the fractions of a valid fraction term
+* @return true if the term is valid, otherwise neither is changed.
+*/
+bool parse_sweep_term(const std::string &term, std::vector<uint16_t> &vertices, std::vector<float> &factors){
+	size_t equals = term.find('=');
+	if (equals == std::string::npos){
+		return false;
+	}
+	std::string key = term.substr(0, equals), value = term.substr(equals + 1);
+	std::vector<double> values;
+	size_t dots = value.find("..");
+	if (key == "vertices" && dots != std::string::npos){
+		// Both ends are checked before the range is filled, so that a huge end neither overflows nor allocates
+		double first, last;
+		if (!ChaosEngine::parse_number(value.substr(0, dots), first) || !ChaosEngine::parse_number(value.substr(dots + 2), last)
+			|| first != std::floor(first) || last != std::floor(last) || first < 3 || last > 255 || first > last){
+			return false;
+		}
+		for (int v = int (first); v <= int (last); v++){
+			values.push_back(v);
+		}
+	}
+	else if (key == "fraction" && std::count(value.begin(), value.end(), ':') == 2){
+		std::replace(value.begin(), value.end(), ':', ' ');
+		std::stringstream ss(value);
+		std::string terms[3];
+		double first, last, step;
+		if (!(ss >> terms[0] >> terms[1] >> terms[2]) || !ChaosEngine::parse_number(terms[0], first) || !ChaosEngine::parse_number(terms[1], last)
+			|| !ChaosEngine::parse_number(terms[2], step) || step <= 0 || first <= 0.0 || last >= 1.0 || first > last){
+			return false;
+		}
+		// Counted rather than accumulated, so that rounding neither drops the last value nor adds one
+		double count = std::floor((last - first) / step + 1e-6) + 1;
+		if (count > MAX_SWEEP_VALUES){
+			return false;
+		}
+		for (uint64_t i = 0; i < uint64_t (count); i++){
+			values.push_back(first + i * step);
+		}
+	}
+	else{
+		std::vector<std::string> items = split_list(value);
+		for (size_t i = 0; i < items.size(); i++){
+			double item;
+			if (!ChaosEngine::parse_number(items[i], item)){
+				return false;
+			}
+			values.push_back(item);
+		}
+	}
+	if (values.empty()){
+		return false;
+	}
+	for (size_t i = 0; i < values.size(); i++){
+		if (key == "vertices" && (values[i] < 3 || values[i] > 255 || values[i] != std::floor(values[i]))){
+			return false;
+		}
+		if (key == "fraction" && (values[i] <= 0.0 || values[i] >= 1.0)){
+			return false;
+		}
+	}
+	if (key == "vertices"){
+		vertices.assign(values.begin(), values.end());
+		return true;
+	}
+	if (key == "fraction"){
+		factors.assign(values.begin(), values.end());
+		return true;
+	}
+	return false;
+}
+
+/**
+* Sizes the grid of config from the screen dimensions and the supersampling factor, unless --render-size gave it.
+*/
+void render_size(){
+	if (!flag_render_size_set){
+		config.width = uint32_t (screen_width) * config.supersample;
+		config.height = uint32_t (screen_height) * config.supersample;
+	}
+}
+
+/**
+* Handles SIGINT by stopping every game of the process, which then ends as if it were done.
+*/
+void signal_interrupt(int _){
+	ChaosEngine::interrupt();
+}
+
+/**
+* Sets up a game on an engine, creating it on first use and resetting it afterwards, so that the games of a mode
+* reuse the memory of one grid. The reason a game could not be set up is written to stderr.
+* @param game: The parameters of the game, sized by render_size
+* @return false if the game could not be set up.
+*/
+bool setup_engine(std::unique_ptr<ChaosEngine> &engine, const ChaosConfig &game){
+	std::string error;
+	if (engine ? !engine->reset(game, &error) : !(engine = ChaosEngine::create(game, &error))){
+		std::cerr << error << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/**
+* Ends a window of the convergence measure at the given totals and starts the next one.
+* @param convergence: The measure to update
+* @param iterations: Iterations run so far
+* @param points: Unique points found so far
+*/
+void measure_convergence(Convergence &convergence, uint64_t iterations, uint64_t points){
+	if (iterations > convergence.iterations){
+		convergence.window = iterations - convergence.iterations;
+		convergence.rate = double (points - convergence.points) * 1e6 / double (convergence.window);
+	}
+	convergence.iterations = iterations;
+	convergence.points = points;
+}
+
+/**
+* Returns the number of iterations over which saturation is measured, a whole number of stepping windows.
+*/
+uint64_t saturation_window(){
+	double steppings = std::ceil(SATURATION_POINTS * 1e6 / (saturation_rate * config.stepping));
+	return std::max(uint64_t (steppings), uint64_t (1)) * config.stepping;
+}
+
+/**
+* Measures the saturation window ending at the given totals, if one has passed.
+* @param saturation: The measure over saturation windows
+* @param iterations: Iterations run so far
+* @param points: Unique points found so far
+* @return Whether the window that ended found new points below saturation_rate.
+*/
+bool check_saturation(Convergence &saturation, uint64_t iterations, uint64_t points){
+	if (iterations - saturation.iterations < saturation_window()){
+		return false;
+	}
+	measure_convergence(saturation, iterations, points);
+	return saturation.rate < saturation_rate;
+}
+
+// Ticks of the statistics' clock per second
+const uint64_t TICKS_PER_SECOND = 1000000000;
+
+/**
+* Starts a new span of the statistics at the walkers' current totals.
+*/
+void reset_stats(FrameStats &stats, uint64_t iterations, uint64_t points){
+	stats.start = stats.lap = stats_ticks();
+	stats.frames = 0;
+	stats.iterations = iterations;
+	stats.points = points;
+	std::fill(stats.phase_ticks, stats.phase_ticks + NUM_PHASES, 0);
+}
+
+/**
+* Returns the seconds since the start of the span.
+*/
+double stats_seconds(const FrameStats &stats){
+	return double (stats_ticks() - stats.start) / TICKS_PER_SECOND;
+}
+
+/**
+* Summarizes the span of the statistics ending at the walkers' current totals: iterations and new points
+* per second, the share of iterations that hit an already marked cell, and for a window the frame rate
+* and mean milliseconds per frame of each phase.
+* @return The lines of the summary.
+*/
+std::vector<std::string> stats_lines(const FrameStats &stats, uint64_t iterations, uint64_t points){
+	double seconds = stats_seconds(stats);
+	uint64_t run = iterations - stats.iterations, found = points - stats.points;
+	std::vector<std::string> lines;
+	std::ostringstream line;
+	line << std::fixed << std::setprecision(0) << "iterations/s: " << run / seconds;
+	lines.push_back(line.str());
+	line.str("");
+	line << "new points/s: " << found / seconds;
+	lines.push_back(line.str());
+	line.str("");
+	line << std::setprecision(2) << "dedup hits: " << (run ? 100.0 * (run - found) / run : 0.0) << "%";
+	lines.push_back(line.str());
+	if (stats.frames > 0){
+		line.str("");
+		line << std::setprecision(1) << "fps: " << stats.frames / seconds;
+		lines.push_back(line.str());
+		line.str("");
+		line << std::setprecision(2) << "frame ms:";
+		for (int phase = 0; phase < NUM_PHASES; phase++){
+			double ms = 1000.0 * stats.phase_ticks[phase] / TICKS_PER_SECOND / stats.frames;
+			line << (phase ? ", " : " ") << PHASE_NAMES[phase] << " " << ms;
+		}
+		lines.push_back(line.str());
+	}
+	return lines;
+}
+
+/**
+* Returns the seconds a span of the statistics lasts: stats_interval, or a second for the overlay alone.
+*/
+double stats_span(){
+	return stats_interval > 0 ? stats_interval : 1.0;
+}
+
+/**
+* Writes the summary lines of the statistics to stderr as one line.
+*/
+void log_stats(const std::vector<std::string> &lines){
+	std::cerr << "Stats:";
+	for (size_t l = 0; l < lines.size(); l++){
+		std::cerr << (l ? ", " : " ") << lines[l];
+	}
+	std::cerr << std::endl;
+}
+
+/**
+* Reads a snapshot written by a checkpoint.
+* @return false if the file could not be read.
+*/
+bool read_snapshot(const std::string &path, std::vector<uint8_t> &snapshot){
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if (!file){
+		return false;
+	}
+	snapshot.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return !file.bad();
+}
+
+/**
+* Runs the game of an engine without a window up to game.iterations iterations, then writes the result to path,
+* or to frame_stream unless it is nullptr. It only reads the options, so that the games of a sweep may run it
+* side by side, each with parameters of its own.
+* @param game: The parameters the engine was set up with
+* @param log: Receives the report of the run
+* @return The exit status of the program.
+*/
+int run_headless(ChaosEngine &engine, const ChaosConfig &game, const std::string &path, std::ostream *frame_stream, std::ostream &log){
+	// The walkers run in segments, no longer than a saturation window when stopping on saturation,
+	// between which they are stopped to measure the convergence and for snapshots
+	uint64_t resumed = engine.iterations();
+	uint64_t num_points = engine.unique_points();
+	Convergence convergence = {resumed, num_points, 0, 0.0};
+	Convergence saturation = convergence;
+	bool saturated = false;
+	uint64_t segment_length = flag_stop_saturated ? std::min(HEADLESS_SEGMENT, saturation_window()) : HEADLESS_SEGMENT;
+	FrameStats stats;
+	reset_stats(stats, resumed, num_points);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point last_checkpoint = start;
+	uint64_t i = resumed;
+	while (i < game.iterations && !engine.stopped() && !saturated){
+		i += engine.step(std::min(game.iterations - i, segment_length));
+		num_points = engine.unique_points();
+		if (i - convergence.iterations >= HEADLESS_SEGMENT){
+			measure_convergence(convergence, i, num_points);
+		}
+		saturated = flag_stop_saturated && check_saturation(saturation, i, num_points);
+		if (stats_interval > 0 && stats_seconds(stats) >= stats_interval){
+			log_stats(stats_lines(stats, i, num_points));
+			reset_stats(stats, i, num_points);
+		}
+		if (flag_checkpoint && std::chrono::duration<double>(std::chrono::steady_clock::now() - last_checkpoint).count() >= checkpoint_interval){
+			engine.checkpoint(checkpoint_path, false);
+			last_checkpoint = std::chrono::steady_clock::now();
+		}
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (convergence.window == 0){
+		measure_convergence(convergence, i, num_points);
+	}
+	if (ChaosEngine::interrupted()){
+		log << std::endl << "Interrupted, keeping the points generated so far." << std::endl;
+	}
+	if (saturated){
+		log << "Saturated after " << i << " iterations: " << saturation.rate << " new points per million iterations over the last "
+			<< saturation.window << " iterations." << std::endl;
+	}
+	if (flag_checkpoint){
+		engine.checkpoint(checkpoint_path, true);
+		log << "Checkpoint written to " << checkpoint_path << "." << std::endl;
+	}
+
+	log << "Generated " << i << " points (" << num_points << " unique) in " << seconds << " s: "
+		<< uint64_t ((i - resumed) / seconds) << " points/second (" << game.kernel << " kernel, " << game.rng << ", seed " << game.seed << ")." << std::endl;
+	log << "Discovery rate: " << convergence.rate << " new points per million iterations over the last "
+		<< convergence.window << " iterations, after a burn-in of " << engine.burn_in() << " iterations." << std::endl;
+
+	// A streamed run only writes an image when asked to with -o
+	if (!game.stream.empty() && !flag_output_set){
+		return 0;
+	}
+	bool written = frame_stream != nullptr ? engine.write_image(*frame_stream, image_format) : engine.write_image(path, image_format);
+	if (!written){
+		std::cerr << "Could not write image to " << path << "." << std::endl;
+		return 1;
+	}
+	log << "Image written to " << path << "." << std::endl;
+	return 0;
+}
+
+/**
+* Writes all of a buffer to a socket.
+* @return false if the connection failed.
+*/
+bool send_all(int fd, const void *data, size_t size){
+	const uint8_t *bytes = static_cast<const uint8_t *>(data);
+	while (size > 0){
+		ssize_t sent = send(fd, bytes, size, MSG_NOSIGNAL);
+		if (sent < 0 && errno == EINTR){
+			continue;
+		}
+		if (sent <= 0){
+			return false;
+		}
+		bytes += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+/**
+* Reads a whole buffer from a socket.
+* @return false if the connection failed or was closed first.
+*/
+bool receive_all(int fd, void *data, size_t size){
+	uint8_t *bytes = static_cast<uint8_t *>(data);
+	while (size > 0){
+		ssize_t received = recv(fd, bytes, size, 0);
+		if (received < 0 && errno == EINTR){
+			continue;
+		}
+		if (received <= 0){
+			return false;
+		}
+		bytes += received;
+		size -= received;
+	}
+	return true;
+}
+
+/**
+* Sends a message over a socket: its size as 64 bits, then its bytes.
+*/
+bool send_message(int fd, const std::vector<uint8_t> &data){
+	uint64_t size = data.size();
+	return send_all(fd, &size, sizeof(size)) && send_all(fd, data.data(), data.size());
+}
+
+/**
+* Receives a message sent by send_message, of at most limit bytes.
+* @return false if the connection failed or the message is too large.
+*/
+bool receive_message(int fd, std::vector<uint8_t> &data, uint64_t limit){
+	uint64_t size;
+	if (!receive_all(fd, &size, sizeof(size)) || size > limit){
+		return false;
+	}
+	data.resize(size);
+	return receive_all(fd, data.data(), size);
+}
+
+/**
+* Appends the raw bytes of a value to a job.
+*/
+template <class T>
+inline void put_value(std::vector<uint8_t> &out, const T &value){
+	const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+	out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+/**
+* Reads the raw bytes of a value of a job.
+* @return false if the input ends before the value.
+*/
+template <class T>
+inline bool get_value(const uint8_t *&in, const uint8_t *end, T &value){
+	if (uint64_t (end - in) < sizeof(T)){
+		return false;
+	}
+	std::memcpy(&value, in, sizeof(T));
+	in += sizeof(T);
+	return true;
+}
+
+/**
+* Connects to the coordinator at worker_address, HOST:PORT, retrying for WORKER_CONNECT_SECONDS
+* so that workers may be started before it.
+* @return The socket, or -1 if no connection could be made.
+*/
+int connect_coordinator(){
+	size_t colon = worker_address.rfind(':');
+	if (colon == std::string::npos){
+		return -1;
+	}
+	std::string host = worker_address.substr(0, colon), port = worker_address.substr(colon + 1);
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(WORKER_CONNECT_SECONDS);
+	while (!ChaosEngine::interrupted()){
+		addrinfo hints, *addresses;
+		std::memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) == 0){
+			for (addrinfo *address = addresses; address != nullptr; address = address->ai_next){
+				int fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+				if (fd >= 0 && connect(fd, address->ai_addr, address->ai_addrlen) == 0){
+					freeaddrinfo(addresses);
+					return fd;
+				}
+				if (fd >= 0){
+					close(fd);
+				}
+			}
+			freeaddrinfo(addresses);
+		}
+		if (std::chrono::steady_clock::now() >= deadline){
+			break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	}
+	return -1;
+}
+
+/**
+* Runs this process as a worker node: connects to the coordinator, takes its node number, seed and number of
+* iterations, runs the walkers on the random streams of the node's seed, and sends back a snapshot of the game.
+* @return The exit status of the program.
+*/
+int run_worker(){
+	int fd = connect_coordinator();
+	if (fd < 0){
+		std::cerr << "Could not connect to coordinator " << worker_address << "." << std::endl;
+		return 1;
+	}
+	std::vector<uint8_t> message;
+	bool received = receive_message(fd, message, 64);
+	const uint8_t *in = message.data(), *end = message.data() + message.size();
+	char magic[sizeof(JOB_MAGIC)];
+	uint32_t node;
+	if (!received || !get_value(in, end, magic) || std::memcmp(magic, JOB_MAGIC, sizeof(magic)) != 0
+		|| !get_value(in, end, node) || !get_value(in, end, config.seed) || !get_value(in, end, config.iterations)){
+		std::cerr << "Could not receive a job from coordinator " << worker_address << "." << std::endl;
+		close(fd);
+		return 1;
+	}
+	std::cout << "Running node " << node << " of coordinator " << worker_address << ": " << config.iterations
+		<< " iterations with seed " << config.seed << "." << std::endl;
+	config.seed = ChaosEngine::node_seed(config.seed, node);
+	std::unique_ptr<ChaosEngine> engine;
+	render_size();
+	if (!setup_engine(engine, config)){
+		close(fd);
+		return 1;
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	uint64_t i = 0;
+	while (i < config.iterations && !engine->stopped()){
+		i += engine->step(std::min(config.iterations - i, HEADLESS_SEGMENT));
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Generated " << i << " points (" << engine->unique_points() << " unique) in " << seconds << " s: "
+		<< uint64_t (i / seconds) << " points/second." << std::endl;
+
+	message = engine->snapshot();
+	bool sent = send_message(fd, message);
+	close(fd);
+	if (!sent){
+		std::cerr << "Could not send the grid to coordinator " << worker_address << "." << std::endl;
+		return 1;
+	}
+	std::cout << "Grid of " << message.size() << " bytes sent to coordinator " << worker_address << "." << std::endl;
+	return 0;
+}
+
+/**
+* Runs this process as the coordinator: waits for num_nodes workers on coordinator_port, hands each its node
+* number, the seed and the number of iterations, then merges the grids they send back into an engine of its own,
+* as they arrive, and writes the image of the sum to output_path.
+* @return The exit status of the program, 1 if any worker's grid could not be merged.
+*/
+int run_coordinator(){
+	std::unique_ptr<ChaosEngine> engine;
+	render_size();
+	if (!setup_engine(engine, config)){
+		return 1;
+	}
+	int server = socket(AF_INET, SOCK_STREAM, 0);
+	int reuse = 1;
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(coordinator_port);
+	if (server < 0 || setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0
+		|| bind(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(server, num_nodes) != 0){
+		std::cerr << "Could not listen on port " << coordinator_port << "." << std::endl;
+		if (server >= 0){
+			close(server);
+		}
+		return 1;
+	}
+	std::cout << "Waiting for " << num_nodes << " workers on port " << coordinator_port << "." << std::endl;
+
+	// Workers are accepted until all have connected, polling so that an interrupt is noticed
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<int> workers;
+	while (workers.size() < num_nodes && !ChaosEngine::interrupted()){
+		pollfd waiting = {server, POLLIN, 0};
+		if (poll(&waiting, 1, 200) <= 0){
+			continue;
+		}
+		sockaddr_in peer;
+		socklen_t peer_size = sizeof(peer);
+		int fd = accept(server, reinterpret_cast<sockaddr *>(&peer), &peer_size);
+		if (fd < 0){
+			continue;
+		}
+		std::vector<uint8_t> job(JOB_MAGIC, JOB_MAGIC + sizeof(JOB_MAGIC));
+		put_value(job, uint32_t (workers.size()));
+		put_value(job, config.seed);
+		put_value(job, config.iterations);
+		if (!send_message(fd, job)){
+			close(fd);
+			continue;
+		}
+		char name[INET_ADDRSTRLEN];
+		inet_ntop(AF_INET, &peer.sin_addr, name, sizeof(name));
+		std::cout << "Worker " << workers.size() << " connected from " << name << "." << std::endl;
+		workers.push_back(fd);
+	}
+	close(server);
+
+	// Grids are received on a thread per worker, and merged one at a time
+	size_t grid_size = engine->grid_bytes();
+	std::mutex merge_mutex;
+	size_t merged = 0;
+	auto receive = [&](size_t node){
+		std::vector<uint8_t> message;
+		ChaosConfig worker_config;
+		uint64_t iterations = 0;
+		bool received = receive_message(workers[node], message, 2 * grid_size + (1 << 20))
+			&& ChaosEngine::snapshot_config(message, worker_config, iterations);
+		close(workers[node]);
+		std::lock_guard<std::mutex> lock(merge_mutex);
+		if (!received){
+			std::cerr << "Could not receive the grid of worker " << node << "." << std::endl;
+			return;
+		}
+		if (!engine->merge(message)){
+			std::cerr << "Worker " << node << " renders a different game. Ignoring its grid." << std::endl;
+			return;
+		}
+		merged++;
+		std::cout << "Merged the grid of worker " << node << " after " << iterations << " iterations." << std::endl;
+	};
+	std::vector<std::thread> threads;
+	for (size_t node = 0; node < workers.size(); node++){
+		threads.push_back(std::thread(receive, node));
+	}
+	for (size_t t = 0; t < threads.size(); t++){
+		threads[t].join();
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	uint64_t iterations = engine->iterations();
+	std::cout << "Merged " << merged << " of " << workers.size() << " grids: " << iterations << " points (" << engine->cells()
+		<< " unique) in " << seconds << " s: " << uint64_t (iterations / seconds) << " points/second over all nodes." << std::endl;
+
+	if (!engine->write_image(output_path, image_format)){
+		std::cerr << "Could not write image to " << output_path << "." << std::endl;
+		return 1;
+	}
+	std::cout << "Image written to " << output_path << "." << std::endl;
+	return merged == num_nodes ? 0 : 1;
+}
+
+/**
+* Timing of the frames run by one bench walker, a frame being stepping iterations.
+*/
+struct FrameTiming {
+	uint64_t iterations;
+	uint64_t frames;
+	double total_ms;
+	double max_ms;
+	uint64_t allocations;
+};
+
+/**
+* Runs a walker of an engine for a number of iterations in frames of stepping iterations, timing each frame
+* and counting the heap allocations of its thread in between.
+*/
+void bench_walker(ChaosEngine &engine, uint16_t walker, uint64_t iterations, FrameTiming &timing){
+	timing = FrameTiming {0, 0, 0.0, 0.0, 0};
+	uint64_t allocations = ChaosEngine::thread_allocations();
+	while (timing.iterations < iterations && !ChaosEngine::interrupted()){
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		timing.iterations += engine.step_walker(walker, std::min(config.stepping, iterations - timing.iterations));
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		timing.frames++;
+		timing.total_ms += ms;
+		timing.max_ms = std::max(timing.max_ms, ms);
+	}
+	timing.allocations = ChaosEngine::thread_allocations() - allocations;
+}
+
+/**
+* Runs one bench configuration, with the current screen dimensions, vertices, factor and threads,
+* and writes its result as a CSV line or JSON object. Allocations are the heap allocations of the whole
+* configuration, loop allocations those made by the walkers' threads while they ran.
+* @return false if the game of the configuration could not be set up.
+*/
+bool run_bench_case(std::unique_ptr<ChaosEngine> &engine, std::ostream &out, bool first){
+	uint64_t allocations = ChaosEngine::process_allocations();
+	render_size();
+	if (!setup_engine(engine, config)){
+		return false;
+	}
+
+	uint16_t walkers = config.threads;
+	std::vector<FrameTiming> timings(walkers);
+	std::vector<std::thread> threads;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (uint16_t t = 1; t < walkers; t++){
+		threads.push_back(std::thread(bench_walker, std::ref(*engine), t, config.iterations / walkers, std::ref(timings[t])));
+	}
+	bench_walker(*engine, 0, config.iterations / walkers + config.iterations % walkers, timings[0]);
+	for (size_t t = 0; t < threads.size(); t++){
+		threads[t].join();
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	FrameTiming total = {0, 0, 0.0, 0.0, 0};
+	for (uint16_t t = 0; t < walkers; t++){
+		total.iterations += timings[t].iterations;
+		total.frames += timings[t].frames;
+		total.total_ms += timings[t].total_ms;
+		total.max_ms = std::max(total.max_ms, timings[t].max_ms);
+		total.allocations += timings[t].allocations;
+	}
+	uint64_t num_points = engine->unique_points();
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	allocations = ChaosEngine::process_allocations() - allocations;
+
+	double hit_rate = total.iterations ? 1.0 - double (num_points) / total.iterations : 0.0;
+	double mean_frame_ms = total.frames ? total.total_ms / total.frames : 0.0;
+	if (flag_bench_json){
+		out << (first ? "[\n" : ",\n") << "  {\"dimensions\": \"" << screen_width << "x" << screen_height << "\""
+			<< ", \"vertices\": " << config.vertices << ", \"fraction\": " << config.fraction << ", \"threads\": " << config.threads
+			<< ", \"kernel\": \"" << config.kernel << "\", \"rng\": \"" << config.rng << "\""
+			<< ", \"iterations\": " << total.iterations << ", \"seconds\": " << seconds
+			<< ", \"iterations_per_second\": " << uint64_t (total.iterations / seconds)
+			<< ", \"unique_points\": " << num_points << ", \"dedup_hit_rate\": " << hit_rate
+			<< ", \"peak_rss_kb\": " << usage.ru_maxrss
+			<< ", \"mean_frame_ms\": " << mean_frame_ms << ", \"max_frame_ms\": " << total.max_ms
+			<< ", \"allocations\": " << allocations << ", \"loop_allocations\": " << total.allocations << "}";
+	}
+	else{
+		if (first){
+			out << "dimensions,vertices,fraction,threads,kernel,rng,iterations,seconds,iterations_per_second,"
+				<< "unique_points,dedup_hit_rate,peak_rss_kb,mean_frame_ms,max_frame_ms,allocations,loop_allocations" << std::endl;
+		}
+		out << screen_width << "x" << screen_height << "," << config.vertices << "," << config.fraction << "," << config.threads
+			<< "," << config.kernel << "," << config.rng
+			<< "," << total.iterations << "," << seconds << "," << uint64_t (total.iterations / seconds)
+			<< "," << num_points << "," << hit_rate << "," << usage.ru_maxrss
+			<< "," << mean_frame_ms << "," << total.max_ms << "," << allocations << "," << total.allocations << std::endl;
+	}
+	return true;
+}
+
+/**
+* Runs every bench configuration, on one engine reset for each, and writes the results to output_path if it
+* was given, or to stdout. Peak RSS is that of the whole process so far, so it never decreases between configurations.
+* @return The exit status of the program.
+*/
+int run_bench(){
+	if (bench_dimensions.empty()){
+		bench_dimensions.push_back(std::make_pair(screen_width, screen_height));
+	}
+	if (bench_vertices.empty()){
+		bench_vertices.push_back(config.vertices);
+	}
+	if (bench_factors.empty()){
+		bench_factors.push_back(config.fraction);
+	}
+	if (bench_threads.empty()){
+		bench_threads.push_back(config.threads);
+	}
+
+	std::ofstream file;
+	if (flag_output_set){
+		file.open(output_path.c_str());
+		if (!file){
+			std::cerr << "Could not write bench results to " << output_path << "." << std::endl;
+			return 1;
+		}
+	}
+	std::ostream &out = flag_output_set ? file : std::cout;
+
+	std::unique_ptr<ChaosEngine> engine;
+	bool first = true;
+	for (size_t d = 0; d < bench_dimensions.size() && !ChaosEngine::interrupted(); d++){
+		for (size_t v = 0; v < bench_vertices.size() && !ChaosEngine::interrupted(); v++){
+			for (size_t f = 0; f < bench_factors.size() && !ChaosEngine::interrupted(); f++){
+				for (size_t t = 0; t < bench_threads.size() && !ChaosEngine::interrupted(); t++){
+					screen_width = bench_dimensions[d].first;
+					screen_height = bench_dimensions[d].second;
+					config.vertices = bench_vertices[v];
+					config.fraction = bench_factors[f];
+					config.threads = bench_threads[t];
+					if (!run_bench_case(engine, out, first)){
+						return 1;
+					}
+					first = false;
+				}
+			}
+		}
+	}
+	if (flag_bench_json && !first){
+		out << "\n]" << std::endl;
+	}
+	if (flag_output_set){
+		std::cout << "Bench results written to " << output_path << "." << std::endl;
+	}
+	return 0;
+}
+
+/**
+* Returns the name of the image a sweep writes for a configuration, such as v4_f055.ppm for 4 vertices
+* and a fraction of 0.55 in PPM.
+*/
+std::string sweep_image_name(uint16_t vertices, float fraction){
+	std::stringstream ss;
+	ss << fraction;
+	std::string digits = ss.str();
+	digits.erase(std::remove(digits.begin(), digits.end(), '.'), digits.end());
+	std::stringstream name;
+	name << "v" << vertices << "_f" << digits << "." << image_format;
+	return name.str();
+}
+
+/**
+* Runs a configuration of the sweep in headless mode with all the walker threads, writing its image to a directory.
+* @param engine: The engine of the job, reset for the configuration
+* @param log: Receives the report of the run
+* @return The exit status of the run.
+*/
+int run_sweep_configuration(std::unique_ptr<ChaosEngine> &engine, const std::string &directory, uint16_t vertices, float fraction,
+	std::ostream &log){
+	ChaosConfig game = config;
+	game.vertices = vertices;
+	game.fraction = fraction;
+	std::string path = directory + "/" + sweep_image_name(game.vertices, game.fraction);
+	log << "Sweeping " << game.vertices << " vertices with a fraction of " << game.fraction << "." << std::endl;
+	if (!setup_engine(engine, game)){
+		return 1;
+	}
+	return run_headless(*engine, game, path, nullptr, log);
+}
+
+/**
+* Runs every configuration of the sweep in headless mode, writing the image of each to the directory given by -o,
+* or to the working directory. The configurations are run by sweep_jobs jobs, one per hardware thread unless set
+* and no more than there are configurations, each on a thread and an engine of its own, reused between its
+* configurations. A job takes the next configuration as it finishes one, until one of them fails. With several
+* jobs, the report of each configuration is written once it is done, so that reports are never interleaved.
+* @return The exit status of the program, that of the first configuration which failed if any did.
+*/
+int run_sweep(){
+	if (sweep_vertices.empty()){
+		sweep_vertices.push_back(config.vertices);
+	}
+	if (sweep_factors.empty()){
+		sweep_factors.push_back(config.fraction);
+	}
+	std::string directory = flag_output_set ? output_path : ".";
+	flag_output_set = true;
+	render_size();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	uint32_t configurations = sweep_vertices.size() * sweep_factors.size();
+	uint32_t wanted_jobs = sweep_jobs > 0 ? sweep_jobs : std::max(std::thread::hardware_concurrency(), 1u);
+	uint16_t jobs = std::min(wanted_jobs, configurations);
+	uint32_t next = 0, runs = 0;
+	int result = 0;
+	std::mutex mutex;
+	auto job = [&](){
+		std::unique_ptr<ChaosEngine> engine;
+		std::unique_lock<std::mutex> lock(mutex);
+		while (next < configurations && result == 0 && !ChaosEngine::interrupted()){
+			uint32_t i = next++;
+			lock.unlock();
+			std::ostringstream report;
+			std::ostream &log = jobs > 1 ? report : std::cout;
+			int status = run_sweep_configuration(engine, directory, sweep_vertices[i / sweep_factors.size()], sweep_factors[i % sweep_factors.size()], log);
+			lock.lock();
+			std::cout << report.str() << std::flush;
+			runs += status == 0;
+			result = result != 0 ? result : status;
+		}
+	};
+	std::vector<std::thread> threads;
+	for (uint16_t j = 1; j < jobs; j++){
+		threads.push_back(std::thread(job));
+	}
+	job();
+	for (size_t j = 0; j < threads.size(); j++){
+		threads[j].join();
+	}
+	if (result != 0){
+		return result;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Swept " << runs << " configurations in " << seconds << " s, written to " << directory << "." << std::endl;
+	return 0;
+}
+
+/**
+* Returns the name of the image of an animation frame, such as frame_0042.ppm.
+*/
+std::string animation_frame_name(uint32_t frame){
+	std::stringstream name;
+	name << "frame_" << std::setw(4) << std::setfill('0') << frame << "." << image_format;
+	return name.str();
+}
+
+/**
+* Runs the frames of the animation in headless mode, one after another on one engine with all the walker threads,
+* writing each to the directory given by -o, or to the working directory, or streaming them to the file, pipe or
+* stdout it names.
+* @param stdout_buffer: The buffer of stdout, which the frames go to when -o is "-"
+* @return The exit status of the program, that of the first frame which failed if any did.
+*/
+int run_animation(std::streambuf *stdout_buffer){
+	std::string target = flag_output_set ? output_path : ".";
+	flag_output_set = true;
+	struct stat info;
+	bool directory = target != "-" && stat(target.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+	std::ostream out(stdout_buffer);
+	std::ofstream file;
+	std::ostream *frame_stream = nullptr;
+	if (!directory){
+		if (target != "-"){
+			file.open(target.c_str(), std::ios::binary);
+			if (!file){
+				std::cerr << "Could not write frames to " << target << "." << std::endl;
+				return 1;
+			}
+		}
+		// A closed reader is reported by the failed write instead of killing the process
+		signal(SIGPIPE, SIG_IGN);
+		frame_stream = target == "-" ? &out : static_cast<std::ostream *>(&file);
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::unique_ptr<ChaosEngine> engine;
+	uint32_t frames = 0;
+	int status = 0;
+	for (uint32_t frame = 0; frame < animate_frames && !ChaosEngine::interrupted() && status == 0; frame++){
+		double t = animate_frames > 1 ? double (frame) / (animate_frames - 1) : 0.0;
+		config.fraction = animate_first + (animate_last - animate_first) * t;
+		std::string path = directory ? target + "/" + animation_frame_name(frame) : target;
+		std::cout << "Animating frame " << frame + 1 << " of " << animate_frames << " with a fraction of " << config.fraction << "." << std::endl;
+		render_size();
+		status = setup_engine(engine, config) ? run_headless(*engine, config, path, frame_stream, std::cout) : 1;
+		frames += status == 0;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Animated " << frames << " frames in " << seconds << " s (" << frames / seconds << " frames/second), written to " << target << "." << std::endl;
+	return status;
+}
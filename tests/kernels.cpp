@@ -0,0 +1,102 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "chaos_engine.h"
+
+// Checks the reference kernels. Every SIMD kernel this CPU and build support must count the same hits in every
+// cell as the lanes kernel, which runs their step rule one lane at a time, on a grid small enough for the walkers
+// to cross every cell many times. The fixed kernel, which moves in integers only, must count the hits it counted
+// when this test was written, on any compiler, math library and CPU.
+
+const uint64_t SEED = 12345;
+const uint64_t ITERATIONS = 400000;
+
+// FNV-1a hashes of the fixed kernel's hits for each game below
+const uint64_t FIXED_HITS[] = {0x401d60f3c916969eULL, 0xeb42fc148216388eULL, 0x735aa1b1fbb53a03ULL, 0xb8c92c652f48ee37ULL};
+
+struct Game {
+	uint16_t vertices;
+	float fraction;
+};
+
+const Game GAMES[] = {{3, 0.5}, {5, 0.6}, {6, 0.45}, {8, 0.7}};
+
+/**
+* Plays a game on a kernel, counting hits per cell on a small grid.
+* @return false if the engine could not be created.
+*/
+bool kernel_hits(const std::string &kernel, const Game &game, std::vector<uint32_t> &hits){
+	ChaosConfig config;
+	config.width = 64;
+	config.height = 48;
+	config.vertices = game.vertices;
+	config.fraction = game.fraction;
+	config.threads = 2;
+	config.seed = SEED;
+	config.density = true;
+	config.kernel = kernel;
+	std::vector<uint32_t> pixels;
+	std::unique_ptr<ChaosEngine> engine = ChaosEngine::create(config);
+	return engine && engine->step(ITERATIONS) == ITERATIONS && engine->framebuffer(pixels, config.width, config.height, &hits);
+}
+
+/**
+* Returns the FNV-1a hash of hit counts.
+*/
+uint64_t hash_hits(const std::vector<uint32_t> &hits){
+	uint64_t hash = 14695981039346656037ULL;
+	for (uint32_t count : hits){
+		for (int byte = 0; byte < 4; byte++){
+			hash = (hash ^ ((count >> (8 * byte)) & 0xFF)) * 1099511628211ULL;
+		}
+	}
+	return hash;
+}
+
+int main(){
+	const char *kernels[] = {"sse4", "avx2", "avx512", "neon"};
+	int failures = 0;
+	for (size_t g = 0; g < sizeof(GAMES) / sizeof(GAMES[0]); g++){
+		const Game &game = GAMES[g];
+		std::string name = "v" + std::to_string(game.vertices) + "/f" + std::to_string(game.fraction).substr(0, 4);
+		std::vector<uint32_t> reference;
+		if (!kernel_hits("lanes", game, reference)){
+			std::cout << "FAIL lanes " << name << ": could not play the game." << std::endl;
+			failures++;
+			continue;
+		}
+		for (const char *kernel : kernels){
+			if (!ChaosEngine::kernel_supported(kernel)){
+				std::cout << "skip " << kernel << " " << name << ": not supported here." << std::endl;
+				continue;
+			}
+			std::vector<uint32_t> hits;
+			if (!kernel_hits(kernel, game, hits)){
+				std::cout << "FAIL " << kernel << " " << name << ": could not play the game." << std::endl;
+				failures++;
+			}
+			else if (hits != reference){
+				std::cout << "FAIL " << kernel << " " << name << ": counted different hits than the lanes kernel." << std::endl;
+				failures++;
+			}
+			else{
+				std::cout << "ok   " << kernel << " " << name << std::endl;
+			}
+		}
+		std::vector<uint32_t> hits;
+		if (!kernel_hits("fixed", game, hits)){
+			std::cout << "FAIL fixed " << name << ": could not play the game." << std::endl;
+			failures++;
+		}
+		else if (hash_hits(hits) != FIXED_HITS[g]){
+			std::cout << "FAIL fixed " << name << ": counted different hits, hash " << std::hex << hash_hits(hits) << std::dec << "." << std::endl;
+			failures++;
+		}
+		else{
+			std::cout << "ok   fixed " << name << std::endl;
+		}
+	}
+	std::cout << (failures ? "Kernel tests failed." : "Kernel tests passed.") << std::endl;
+	return failures ? 1 : 0;
+}
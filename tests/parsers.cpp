@@ -0,0 +1,232 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "chaos_engine.h"
+#include "chaos_internal.h"
+#include "chaos_program.h"
+
+using namespace chaos;
+
+// Checks the parsers of the IFS rules and the tables they are drawn from. IFS files and --weights arguments with
+// a token that is not a number, or the wrong number of values, must be rejected and leave what they set as it was.
+// The alias tables built from the weights must then draw every vertex in proportion to its weight, none that
+// are restricted from the previous vertex, and every vertex alike when the weights do not match the vertices.
+// Sweep terms must expand to the values they name, and be rejected, leaving the sweep as it was, when they are
+// not numbers, name an empty or out of range range, or expand to more than MAX_SWEEP_VALUES values.
+
+const uint32_t DRAWS = 1000000;
+
+int failures = 0;
+
+/**
+* Reports a check, counting it as a failure unless it passed.
+*/
+void report(bool passed, const std::string &name, const std::string &failure){
+	if (passed){
+		std::cout << "ok   " << name << std::endl;
+	}
+	else{
+		std::cout << "FAIL " << name << ": " << failure << "." << std::endl;
+		failures++;
+	}
+}
+
+/**
+* Reads an IFS file of the given text into a config which already holds a map.
+* @param maps: Set to the number of maps of the config afterwards
+* @return Whether the file was read.
+*/
+bool read_text(const std::string &text, size_t &maps){
+	char path[] = "/tmp/chaos_ifs_XXXXXX";
+	int fd = mkstemp(path);
+	if (fd < 0){
+		return false;
+	}
+	close(fd);
+	std::ofstream(path) << text;
+	ChaosConfig config;
+	config.maps.push_back(ChaosMap {1, 0, 0, 1, 0, 0});
+	bool read = ChaosEngine::read_ifs(path, config);
+	unlink(path);
+	maps = config.maps.size();
+	return read;
+}
+
+void test_ifs_files(){
+	const std::string map = "0.5 0.5 0 0 0.5 0 0\n";
+	size_t maps;
+	bool read = read_text(map + "# a comment\n0.25 0.5 0 0 0.5 0.5 0 # another\n\nframe -1 -1 2 2\n", maps);
+	report(read && maps == 2, "ifs/valid", "a valid file was not read into its two maps");
+
+	const char *invalid[][2] = {
+		{"a value that is not a number", "0.5 0.5 0 0 0.5 x 0\n"},
+		{"a value with trailing text", "0.5 0.5 0 0 0.5 0 0.5x\n"},
+		{"a weight that is not a number", "w 0.5 0 0 0.5 0 0\n"},
+		{"a value that is not finite", "0.5 0.5 0 0 0.5 nan 0\n"},
+		{"a value out of range", "0.5 0.5 0 0 0.5 1e999 0\n"},
+		{"a negative weight", "-0.5 0.5 0 0 0.5 0 0\n"},
+		{"five values", "0.5 0.5 0 0 0.5 0\n"},
+		{"seven values", "0.5 0.5 0 0 0.5 0 0 0\n"},
+		{"a weight alone", "0.5\n"},
+		{"a frame of three values", "frame 0 0 1\n"},
+		{"a frame of five values", "frame 0 0 1 1 1\n"},
+		{"a frame that is not a number", "frame 0 0 1 y\n"},
+		{"an empty frame", "frame 1 0 0 1\n"},
+		{"no maps", "# nothing\n"},
+		{"no weight", "0 0.5 0 0 0.5 0 0\n"},
+	};
+	for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++){
+		std::string text = invalid[i][1];
+		if (text[0] == 'f'){
+			text = map + text;
+		}
+		read = read_text(text, maps);
+		report(!read && maps == 1, std::string ("ifs/") + invalid[i][0], read ? "the file was read" : "the maps were changed");
+	}
+	std::string many;
+	for (int i = 0; i < 256; i++){
+		many += map;
+	}
+	read = read_text(many, maps);
+	report(!read && maps == 1, "ifs/256 maps", "more maps than vertices were read");
+}
+
+void test_weights(){
+	std::vector<float> weights;
+	bool parsed = parse_weights("1,2.5,0,4", weights);
+	report(parsed && weights == std::vector<float> {1, 2.5, 0, 4}, "weights/valid", "valid weights were not parsed");
+
+	const char *invalid[][2] = {
+		{"a weight that is not a number", "1,x,2"},
+		{"a weight with trailing text", "1,2x"},
+		{"an empty weight", "1,,2"},
+		{"a negative weight", "1,-1"},
+		{"a weight that is not finite", "1,inf"},
+		{"a weight out of range", "1,1e999"},
+		{"only zero weights", "0,0,0"},
+		{"no weights", ""},
+	};
+	for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++){
+		weights.assign(3, 1.0f);
+		parsed = parse_weights(invalid[i][1], weights);
+		report(!parsed && weights.empty(), std::string ("weights/") + invalid[i][0], parsed ? "the weights were parsed" : "the weights were not cleared");
+	}
+}
+
+/**
+* Draws vertices from the alias table of a previous vertex of a game, and compares their frequencies to the
+* probabilities expected, within six standard deviations.
+* @return A description of the first frequency out of tolerance, or an empty string.
+*/
+std::string alias_frequencies(const ChaosConfig &config, uint32_t previous, const std::vector<double> &expected){
+	Game game;
+	std::string error;
+	if (!game.setup(config, &error)){
+		return "could not set the game up: " + error;
+	}
+	uint32_t n = game.num_vertices;
+	std::vector<uint32_t> counts(n, 0);
+	Xoshiro256 rng;
+	rng.seed(7, 0);
+	for (uint32_t i = 0; i < DRAWS; i++){
+		counts[choose_vertex(rng.next_u32(), n, previous, game.alias_threshold.data(), game.alias_other.data())]++;
+	}
+	for (uint32_t v = 0; v < n; v++){
+		double frequency = double (counts[v]) / DRAWS, p = expected[v];
+		double tolerance = 6 * std::sqrt(p * (1 - p) / DRAWS);
+		if (std::fabs(frequency - p) > tolerance || (p == 0 && counts[v] > 0)){
+			return "vertex " + std::to_string(v) + " drawn with frequency " + std::to_string(frequency)
+				+ " instead of " + std::to_string(p);
+		}
+	}
+	return "";
+}
+
+void test_alias_tables(){
+	ChaosConfig config;
+	config.width = 64;
+	config.height = 64;
+	config.vertices = 5;
+	config.weights = {1, 2, 3, 0, 4};
+	std::string failure = alias_frequencies(config, 0, {0.1, 0.2, 0.3, 0, 0.4});
+	report(failure.empty(), "alias/weights", failure);
+
+	config.restricted = {0};
+	failure = alias_frequencies(config, 2, {1.0 / 7, 2.0 / 7, 0, 0, 4.0 / 7});
+	report(failure.empty(), "alias/restricted", failure);
+
+	config.restricted.clear();
+	config.weights = {1, 2, 3};
+	failure = alias_frequencies(config, 0, {0.2, 0.2, 0.2, 0.2, 0.2});
+	report(failure.empty(), "alias/weights not one per vertex", failure);
+
+	config.vertices = 255;
+	config.weights.assign(255, 1);
+	config.weights[254] = 255;
+	std::vector<double> expected(255, 1.0 / 509);
+	expected[254] = 255.0 / 509;
+	failure = alias_frequencies(config, 0, expected);
+	report(failure.empty(), "alias/255 vertices", failure);
+}
+
+void test_sweep_terms(){
+	std::vector<uint16_t> vertices;
+	std::vector<float> factors;
+	bool parsed = parse_sweep_term("vertices=3..6", vertices, factors);
+	report(parsed && vertices == std::vector<uint16_t> {3, 4, 5, 6} && factors.empty(), "sweep/vertex range", "the range was not expanded");
+	parsed = parse_sweep_term("vertices=5,3,8", vertices, factors);
+	report(parsed && vertices == std::vector<uint16_t> {5, 3, 8}, "sweep/vertex list", "the list was not parsed");
+	parsed = parse_sweep_term("fraction=0.4:0.6:0.1", vertices, factors);
+	report(parsed && factors.size() == 3 && std::fabs(factors[2] - 0.6f) < 1e-6f, "sweep/fraction range",
+		"the range was not expanded to both its ends");
+	parsed = parse_sweep_term("fraction=0.10000:0.75535:0.00001", vertices, factors);
+	report(parsed && factors.size() == MAX_SWEEP_VALUES, "sweep/fraction range of the most values",
+		"a range of MAX_SWEEP_VALUES values was not expanded");
+
+	const char *invalid[][2] = {
+		{"a vertex range to the largest int", "vertices=3..2147483647"},
+		{"a vertex range past the largest int", "vertices=3..99999999999999999999"},
+		{"a vertex range below 3", "vertices=2..5"},
+		{"a descending vertex range", "vertices=6..3"},
+		{"a vertex range of fractions", "vertices=3.5..6"},
+		{"a vertex range without an end", "vertices=3.."},
+		{"a vertex range that is not numeric", "vertices=a..b"},
+		{"a vertex list that is not numeric", "vertices=3,x"},
+		{"a vertex list with an empty item", "vertices=3,,5"},
+		{"a vertex list out of range", "vertices=3,256"},
+		{"a descending fraction range", "fraction=0.5:0.4:0.1"},
+		{"a fraction range with a zero step", "fraction=0.4:0.6:0"},
+		{"a fraction range with a negative step", "fraction=0.4:0.6:-0.1"},
+		{"a fraction range reaching 1", "fraction=0.4:1:0.1"},
+		{"a fraction range from 0", "fraction=0:0.5:0.1"},
+		{"a fraction range that is not numeric", "fraction=a:b:c"},
+		{"a fraction range with trailing text", "fraction=0.4:0.6:0.1x"},
+		{"a fraction range of one more than the most values", "fraction=0.10000:0.75536:0.00001"},
+		{"a fraction range of far more than the most values", "fraction=0.1:0.9:1e-300"},
+		{"a fraction that is not numeric", "fraction=half"},
+		{"an empty value", "fraction="},
+		{"an unknown key", "threads=1..4"},
+		{"no key", "3..6"},
+	};
+	for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++){
+		vertices.assign(1, 7);
+		factors.assign(1, 0.25f);
+		parsed = parse_sweep_term(invalid[i][1], vertices, factors);
+		bool unchanged = vertices == std::vector<uint16_t> {7} && factors == std::vector<float> {0.25f};
+		report(!parsed && unchanged, std::string ("sweep/") + invalid[i][0], parsed ? "the term was parsed" : "the sweep was changed");
+	}
+}
+
+int main(){
+	test_ifs_files();
+	test_weights();
+	test_alias_tables();
+	test_sweep_terms();
+	std::cout << (failures ? "Parser tests failed." : "Parser tests passed.") << std::endl;
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,185 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <zlib.h>
+
+#include "chaos_engine.h"
+
+// Checks the PNG images of the engine against its PPM images of the same grid. The images are tall enough for
+// several bands of 64 rows, the last one partial, each written as its own IDAT chunk with its own piece of the
+// zlib stream. The PNG must be framed as such, with valid chunk CRCs, its zlib stream must inflate with zlib's
+// own uncompress and end with the Adler-32 of the filtered rows, and the unfiltered rows must be the PPM's pixels.
+
+// Rows of a band of an exported image
+const uint32_t BAND_ROWS = 64;
+
+/**
+* Reads a big-endian 32-bit number.
+*/
+uint32_t read_u32(const uint8_t *data){
+	return uint32_t (data[0]) << 24 | uint32_t (data[1]) << 16 | uint32_t (data[2]) << 8 | data[3];
+}
+
+/**
+* A PNG read back: its dimensions, its IDAT chunks and their zlib stream, and the unfiltered RGB pixels.
+*/
+struct Png {
+	uint32_t width, height;
+	uint32_t idat_chunks;
+	std::vector<uint8_t> zlib;
+	std::vector<uint8_t> filtered;
+	std::vector<uint8_t> rgb;
+};
+
+/**
+* Splits a PNG into chunks, checking their framing and CRCs, and inflates its image.
+* @return A description of the first error, or an empty string.
+*/
+std::string read_png(const std::string &file, Png &png){
+	const uint8_t *data = reinterpret_cast<const uint8_t *>(file.data());
+	const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+	if (file.size() < 8 || std::memcmp(data, signature, 8) != 0){
+		return "no PNG signature";
+	}
+	size_t at = 8;
+	png.idat_chunks = 0;
+	bool header = false, end = false;
+	while (at < file.size() && !end){
+		if (file.size() - at < 12){
+			return "a truncated chunk";
+		}
+		uint32_t length = read_u32(data + at);
+		std::string type = file.substr(at + 4, 4);
+		if (file.size() - at - 12 < length){
+			return "a chunk longer than the file";
+		}
+		const uint8_t *body = data + at + 8;
+		if (crc32(crc32(0, data + at + 4, 4), body, length) != read_u32(body + length)){
+			return "a bad CRC in " + type;
+		}
+		if (type == "IHDR"){
+			if (header || at != 8 || length != 13){
+				return "a misplaced IHDR";
+			}
+			png.width = read_u32(body);
+			png.height = read_u32(body + 4);
+			const uint8_t format[5] = {8, 2, 0, 0, 0};
+			if (std::memcmp(body + 8, format, 5) != 0){
+				return "an IHDR other than 8-bit RGB";
+			}
+			header = true;
+		}
+		else if (type == "IDAT"){
+			if (!header){
+				return "an IDAT before IHDR";
+			}
+			png.zlib.insert(png.zlib.end(), body, body + length);
+			png.idat_chunks++;
+		}
+		else if (type == "IEND"){
+			end = length == 0;
+			if (!end){
+				return "an IEND with data";
+			}
+		}
+		else{
+			return "an unexpected " + type + " chunk";
+		}
+		at += 12 + length;
+	}
+	if (!end || at != file.size()){
+		return "no IEND at the end";
+	}
+
+	size_t row_size = size_t (png.width) * 3 + 1;
+	png.filtered.resize(row_size * png.height);
+	uLongf size = png.filtered.size();
+	if (png.zlib.size() < 6 || png.zlib[0] != 0x78 || (png.zlib[0] << 8 | png.zlib[1]) % 31 != 0){
+		return "no zlib header";
+	}
+	if (uncompress(png.filtered.data(), &size, png.zlib.data(), png.zlib.size()) != Z_OK || size != png.filtered.size()){
+		return "a zlib stream that does not inflate to the rows";
+	}
+	if (read_u32(&png.zlib[png.zlib.size() - 4]) != adler32(adler32(0, nullptr, 0), png.filtered.data(), png.filtered.size())){
+		return "a wrong Adler-32";
+	}
+
+	// Only the filters the engine writes, None and Sub, are undone
+	png.rgb.resize(size_t (png.width) * 3 * png.height);
+	for (uint32_t y = 0; y < png.height; y++){
+		const uint8_t *row = &png.filtered[y * row_size];
+		uint8_t *out = &png.rgb[y * (row_size - 1)];
+		if (row[0] > 1){
+			return "a row filtered with filter " + std::to_string(row[0]);
+		}
+		for (size_t i = 0; i + 1 < row_size; i++){
+			out[i] = row[i + 1] + (row[0] == 1 && i >= 3 ? out[i - 3] : 0);
+		}
+	}
+	return "";
+}
+
+/**
+* Plays a game and compares its PNG image to its PPM image.
+* @return A description of the first difference, or an empty string.
+*/
+std::string compare_images(bool density, uint32_t supersample){
+	ChaosConfig config;
+	config.width = 150 * supersample;
+	config.height = 3 * BAND_ROWS * supersample + 8 * supersample;
+	config.vertices = 5;
+	config.threads = 2;
+	config.seed = 12345;
+	config.density = density;
+	config.supersample = supersample;
+	std::unique_ptr<ChaosEngine> engine = ChaosEngine::create(config);
+	if (!engine || engine->step(400000) != 400000){
+		return "could not play the game";
+	}
+	std::ostringstream png_stream, ppm_stream;
+	if (!engine->write_image(png_stream, "png") || !engine->write_image(ppm_stream, "ppm")){
+		return "could not write the images";
+	}
+	Png png;
+	std::string error = read_png(png_stream.str(), png);
+	if (!error.empty()){
+		return "the PNG has " + error;
+	}
+	uint32_t width = config.width / supersample, height = config.height / supersample;
+	if (png.width != width || png.height != height){
+		return "the PNG has the wrong dimensions";
+	}
+	if (png.idat_chunks != (height + BAND_ROWS - 1) / BAND_ROWS){
+		return "the PNG has " + std::to_string(png.idat_chunks) + " IDAT chunks, not one per band";
+	}
+	std::string ppm = ppm_stream.str();
+	std::string ppm_header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+	if (ppm.compare(0, ppm_header.size(), ppm_header) != 0 || ppm.size() != ppm_header.size() + png.rgb.size()){
+		return "the PPM has the wrong header or size";
+	}
+	if (std::memcmp(ppm.data() + ppm_header.size(), png.rgb.data(), png.rgb.size()) != 0){
+		return "the PNG and PPM pixels differ";
+	}
+	return "";
+}
+
+int main(){
+	int failures = 0;
+	for (int density = 0; density < 2; density++){
+		for (uint32_t supersample = 1; supersample <= 2; supersample++){
+			std::string name = std::string (density ? "density" : "occupancy") + "/supersample " + std::to_string(supersample);
+			std::string failure = compare_images(density, supersample);
+			if (!failure.empty()){
+				std::cout << "FAIL " << name << ": " << failure << "." << std::endl;
+				failures++;
+			}
+			else{
+				std::cout << "ok   " << name << std::endl;
+			}
+		}
+	}
+	std::cout << (failures ? "PNG tests failed." : "PNG tests passed.") << std::endl;
+	return failures ? 1 : 0;
+}
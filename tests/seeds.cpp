@@ -0,0 +1,69 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+
+#include "chaos_engine.h"
+#include "chaos_internal.h"
+
+using namespace chaos;
+
+// Checks that the nodes of a distributed render play different games: the grids of two nodes given the same
+// seed must differ, with every generator and kernel, while the same node seeded twice must draw the same grid.
+// The second node and the repeat of the first play side by side, each on an engine of its own, as the
+// engines of one process must not share their games.
+
+const uint64_t SEED = 12345;
+const uint64_t ITERATIONS = 200000;
+
+/**
+* Plays node's share of a distributed game and renders its grid.
+* @return false if the engine could not be created.
+*/
+bool node_grid(const std::string &rng, const std::string &kernel, uint32_t node, std::vector<uint32_t> &pixels){
+	ChaosConfig config;
+	config.threads = 2;
+	config.seed = node_seed(SEED, node);
+	config.rng = rng;
+	config.kernel = kernel;
+	std::unique_ptr<ChaosEngine> engine = ChaosEngine::create(config);
+	return engine && engine->step(ITERATIONS) == ITERATIONS && engine->framebuffer(pixels, config.width, config.height);
+}
+
+int main(){
+	const char *rngs[] = {"xoshiro256", "pcg32", "splitmix"};
+	const char *kernels[] = {"scalar", "fixed"};
+	int failures = 0;
+	for (const char *rng : rngs){
+		for (const char *kernel : kernels){
+			std::vector<uint32_t> first, again, second;
+			bool played_first = node_grid(rng, kernel, 0, first), played_again = false, played_second = false;
+			std::thread other([&](){
+				played_second = node_grid(rng, kernel, 1, second);
+			});
+			played_again = node_grid(rng, kernel, 0, again);
+			other.join();
+			if (!played_first || !played_again || !played_second){
+				std::cout << "FAIL " << rng << "/" << kernel << ": could not play the game." << std::endl;
+				failures++;
+			}
+			else if (first != again){
+				std::cout << "FAIL " << rng << "/" << kernel << ": node 0 drew different grids from the same seed." << std::endl;
+				failures++;
+			}
+			else if (first == second){
+				std::cout << "FAIL " << rng << "/" << kernel << ": nodes 0 and 1 drew the same grid." << std::endl;
+				failures++;
+			}
+			else{
+				std::cout << "ok   " << rng << "/" << kernel << std::endl;
+			}
+		}
+	}
+	if (node_seed(SEED, 0) != SEED){
+		std::cout << "FAIL node 0 does not play with the game's seed." << std::endl;
+		failures++;
+	}
+	std::cout << (failures ? "Seed tests failed." : "Seed tests passed.") << std::endl;
+	return failures ? 1 : 0;
+}
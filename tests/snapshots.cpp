@@ -0,0 +1,166 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "chaos_engine.h"
+
+// Checks that a game restored from a snapshot continues exactly where it left off: a game played part of the way,
+// snapshotted and restored into a fresh engine of the same parameters must draw the same grid as the original
+// once both play the rest of the way, in occupancy and density mode. The cells and hit counts are compared, not
+// the snapshots, whose walker states have padding. Truncated snapshots, and snapshots of another game, must be
+// rejected and leave the game as it was. A snapshot of the lanes kernel must restore into a game of the best SIMD
+// kernel of the CPU, and the other way round, as they draw the same points.
+
+const uint64_t SEED = 12345;
+const uint64_t FIRST = 300000;
+const uint64_t REST = 500000;
+
+/**
+* Returns the configuration of the game of a test.
+*/
+ChaosConfig test_config(const std::string &kernel, bool density){
+	ChaosConfig config;
+	config.width = 256;
+	config.height = 192;
+	config.vertices = 5;
+	config.fraction = 0.55;
+	config.threads = 2;
+	config.seed = SEED;
+	config.density = density;
+	config.kernel = kernel;
+	return config;
+}
+
+/**
+* Renders the grid of an engine: its pixels, and the cells or hits of each pixel.
+*/
+bool grid(const ChaosEngine &engine, std::vector<uint32_t> &pixels, std::vector<uint32_t> &hits){
+	return engine.framebuffer(pixels, engine.width(), engine.height(), &hits);
+}
+
+/**
+* Plays a game part of the way, restores a snapshot of it into a fresh engine and plays both the rest of the way.
+* @param restored_kernel: The kernel of the fresh engine
+* @return A description of the first difference, or an empty string if the games drew the same grid.
+*/
+std::string round_trip(const std::string &kernel, const std::string &restored_kernel, bool density){
+	ChaosConfig config = test_config(kernel, density);
+	std::unique_ptr<ChaosEngine> original = ChaosEngine::create(config);
+	std::unique_ptr<ChaosEngine> restored = ChaosEngine::create(test_config(restored_kernel, density));
+	if (!original || !restored){
+		return "could not play the game";
+	}
+	original->step(FIRST);
+	std::vector<uint8_t> snapshot = original->snapshot();
+	if (!restored->restore(snapshot)){
+		return "the snapshot was rejected";
+	}
+	ChaosConfig resumed;
+	uint64_t iterations;
+	if (!ChaosEngine::snapshot_config(snapshot, resumed, iterations) || !ChaosEngine::create(resumed)){
+		return "the game of the snapshot could not be set up";
+	}
+	if (restored->iterations() != original->iterations() || restored->unique_points() != original->unique_points()){
+		return "the restored game counts different iterations or points";
+	}
+	original->step(REST);
+	restored->step(REST);
+	std::vector<uint32_t> pixels, hits, restored_pixels, restored_hits;
+	if (!grid(*original, pixels, hits) || !grid(*restored, restored_pixels, restored_hits)){
+		return "could not render the grids";
+	}
+	if (hits != restored_hits || pixels != restored_pixels){
+		return "the restored game drew a different grid";
+	}
+	if (restored->iterations() != original->iterations() || restored->unique_points() != original->unique_points()){
+		return "the restored game counts different iterations or points";
+	}
+	return "";
+}
+
+/**
+* Restores invalid snapshots of a game played part of the way into another engine of the same game.
+* @return A description of the first snapshot accepted, or of a change to the game, or an empty string.
+*/
+std::string rejection(const std::string &kernel, bool density){
+	ChaosConfig config = test_config(kernel, density);
+	std::unique_ptr<ChaosEngine> played = ChaosEngine::create(config);
+	std::unique_ptr<ChaosEngine> engine = ChaosEngine::create(config);
+	ChaosConfig other = config;
+	other.vertices = 6;
+	std::unique_ptr<ChaosEngine> other_game = ChaosEngine::create(other);
+	other = config;
+	other.threads = 3;
+	std::unique_ptr<ChaosEngine> other_walkers = ChaosEngine::create(other);
+	other = config;
+	other.seed = SEED + 1;
+	std::unique_ptr<ChaosEngine> other_seed = ChaosEngine::create(other);
+	if (!played || !engine || !other_game || !other_walkers || !other_seed){
+		return "could not play the game";
+	}
+	played->step(FIRST);
+	other_game->step(FIRST);
+	other_walkers->step(FIRST);
+	other_seed->step(FIRST);
+	engine->step(FIRST / 2);
+	std::vector<uint32_t> pixels, hits, after_pixels, after_hits;
+	grid(*engine, pixels, hits);
+	uint64_t iterations = engine->iterations();
+
+	std::vector<uint8_t> snapshot = played->snapshot();
+	std::vector<std::pair<std::string, std::vector<uint8_t>>> invalid;
+	invalid.push_back(std::make_pair("an empty snapshot", std::vector<uint8_t>()));
+	invalid.push_back(std::make_pair("a snapshot cut in half", std::vector<uint8_t>(snapshot.begin(), snapshot.begin() + snapshot.size() / 2)));
+	invalid.push_back(std::make_pair("a snapshot missing its last byte", std::vector<uint8_t>(snapshot.begin(), snapshot.end() - 1)));
+	invalid.push_back(std::make_pair("a snapshot of another polygon", other_game->snapshot()));
+	invalid.push_back(std::make_pair("a snapshot of more walkers", other_walkers->snapshot()));
+	invalid.push_back(std::make_pair("a snapshot of another seed", other_seed->snapshot()));
+	for (size_t i = 0; i < invalid.size(); i++){
+		if (engine->restore(invalid[i].second)){
+			return invalid[i].first + " was restored";
+		}
+		grid(*engine, after_pixels, after_hits);
+		if (after_pixels != pixels || after_hits != hits || engine->iterations() != iterations){
+			return invalid[i].first + " changed the game";
+		}
+	}
+	return "";
+}
+
+int main(){
+	const char *kernels[] = {"scalar", "fixed", "lanes"};
+	int failures = 0;
+	for (const char *kernel : kernels){
+		for (int density = 0; density < 2; density++){
+			std::string name = std::string (kernel) + (density ? "/density" : "/occupancy");
+			std::string failure = round_trip(kernel, kernel, density);
+			if (failure.empty()){
+				failure = rejection(kernel, density);
+			}
+			if (!failure.empty()){
+				std::cout << "FAIL " << name << ": " << failure << "." << std::endl;
+				failures++;
+			}
+			else{
+				std::cout << "ok   " << name << std::endl;
+			}
+		}
+	}
+	std::string simd = ChaosEngine::resolve_kernel("simd");
+	if (simd != "scalar"){
+		const std::string pairs[][2] = {{"lanes", simd}, {simd, "lanes"}};
+		for (const auto &pair : pairs){
+			std::string name = pair[0] + " into " + pair[1];
+			std::string failure = round_trip(pair[0], pair[1], true);
+			if (!failure.empty()){
+				std::cout << "FAIL " << name << ": " << failure << "." << std::endl;
+				failures++;
+			}
+			else{
+				std::cout << "ok   " << name << std::endl;
+			}
+		}
+	}
+	std::cout << (failures ? "Snapshot tests failed." : "Snapshot tests passed.") << std::endl;
+	return failures ? 1 : 0;
+}